@@ -0,0 +1,260 @@
+/**
+ * @file:  bench.main.cpp
+ * @brief: Micro Test self benchmark.
+ *
+ * @description
+ * Measures the overhead Micro Test adds per assertion and per test block,
+ * for each test helper, in each report mode and across suite sizes.
+ *
+ * License: GNU Public License (GNU GPL)
+ * Copyright (c) 2016 Rajinder Yadav <devguy.ca@gmail.com>
+ *
+ * Notice: This Software is provided as-is without warrant.
+ */
+
+// Usage: micro_test_bench [--max=assertions] [--output=file]
+//
+// Suite sizes run from 1k up to --max assertions (default 10M) in steps of
+// 10x. Results are printed as a table and written as JSON to --output
+// (default micro_test_bench.json) so they can be tracked over time.
+//
+// Console output of the test runner goes to a discarding stream, the
+// formatting cost of each report mode is measured, the terminal is not.
+//
+// Build in Release mode for meaningful numbers.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+
+#include "micro-test.hpp"
+
+namespace
+{
+   // Stream buffer that throws away everything written to it.
+   class NullBuffer : public std::streambuf
+   {
+   protected:
+      int overflow( int c )
+      {
+         return c;
+      }
+      std::streamsize xsputn( const char *, std::streamsize n )
+      {
+         return n;
+      }
+   };
+
+   struct Result
+   {
+      std::string mode;
+      std::string helper;
+      std::size_t assertions;
+      double seconds;
+   };
+
+   typedef std::function<void( MicroTest::TestRunner &, std::size_t )> bench_t;
+
+   struct Helper
+   {
+      const char * name;
+      bench_t run;
+   };
+
+   // Run i_count assertions of one helper with a fresh runner in i_mode.
+   double Measure( const std::string & i_mode, const bench_t & i_run, const std::size_t i_count )
+   {
+      const char * argv[] = { "micro_test_bench", i_mode.c_str() };
+      MicroTest::TestRunner test( 2, argv );
+
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      i_run( test, i_count );
+      return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+   }
+}
+
+int main( int argc, char * argv[] )
+{
+   std::size_t max_assertions = 10000000;
+   std::string output( "micro_test_bench.json" );
+
+   for ( int i = 1; i < argc; ++i )
+   {
+      const std::string arg( argv[i] );
+
+      if ( arg.compare( 0, 6, "--max=" ) == 0 )
+      {
+         max_assertions = std::strtoull( arg.c_str() + 6, nullptr, 10 );
+      }
+      else if ( arg.compare( 0, 9, "--output=" ) == 0 )
+      {
+         output = arg.substr( 9 );
+      }
+      else
+      {
+         std::cout << "Usage: " << argv[0] << " [--max=assertions] [--output=file]\n";
+         return 1;
+      }
+   }
+
+   // Half the checks fail so both report paths are exercised.
+   const Helper helpers[] =
+   {
+      {
+         "check", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test( ( i & 1 ) == 0 );
+            }
+         }
+      },
+      {
+         "eq", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test.eq( static_cast<int>( i & 1 ), 0 );
+            }
+         }
+      },
+      {
+         "eq_string", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            const std::string s1( "Micro Test makes testing fun!" );
+            const std::string s2( "Micro Test makes testing fun?" );
+
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test.eq( s1, ( i & 1 ) ? s2 : s1 );
+            }
+         }
+      },
+      {
+         "all", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test.all( true, ( i & 1 ) == 0, true );
+            }
+         }
+      },
+      {
+         "ex", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test.ex<int>( [i]
+               {
+                  if ( ( i & 1 ) == 0 )
+                  {
+                     throw 1;
+                  }
+               } );
+            }
+         }
+      },
+      {
+         "ex_none", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test.ex_none( []
+               {
+               } );
+            }
+         }
+      },
+      {
+         "fixture", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            int * value = nullptr;
+
+            test.fixture(
+               setup_fixture
+            {
+               value = new int( 1 );
+            },
+            cleanup_fixture
+            {
+               delete value;
+               value = nullptr;
+            } );
+
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test = "Fixture value is set";
+               test.eq( *value, static_cast<int>( i & 1 ) );
+            }
+
+            test.fixture();
+         }
+      },
+      {
+         "test_block", []( MicroTest::TestRunner & test, std::size_t n )
+         {
+            for ( std::size_t i = 0; i < n; ++i )
+            {
+               test = "Test block with a description";
+               test( ( i & 1 ) == 0 );
+            }
+         }
+      },
+   };
+
+   const char * const modes[] = { "-a", "-f", "-s" };
+
+   NullBuffer null_buffer;
+   std::streambuf * const clog_buffer = std::clog.rdbuf();
+   std::vector<Result> results;
+
+   std::cout << "Micro Test v" << MicroTest::VERSION << " self benchmark\n\n"
+             << "mode  helper        assertions    ns/assertion\n";
+
+   for ( std::size_t size = 1000; size <= max_assertions; size *= 10 )
+   {
+      for ( std::size_t m = 0; m < sizeof modes / sizeof modes[0]; ++m )
+      {
+         for ( std::size_t h = 0; h < sizeof helpers / sizeof helpers[0]; ++h )
+         {
+            std::clog.rdbuf( &null_buffer );
+            const double seconds = Measure( modes[m], helpers[h].run, size );
+            std::clog.rdbuf( clog_buffer );
+
+            const Result result = { modes[m], helpers[h].name, size, seconds };
+            results.push_back( result );
+
+            std::cout << std::left << std::setw( 6 ) << result.mode
+                      << std::setw( 14 ) << result.helper
+                      << std::right << std::setw( 10 ) << result.assertions
+                      << std::setw( 16 ) << std::fixed << std::setprecision( 1 )
+                      << seconds * 1e9 / size << std::endl;
+         }
+      }
+   }
+
+   std::ofstream out( output.c_str() );
+   out << std::fixed << "{\n  \"version\": \"" << MicroTest::VERSION << "\",\n  \"results\": [\n";
+
+   for ( std::size_t i = 0; i < results.size(); ++i )
+   {
+      out << "    {\"mode\": \"" << results[i].mode
+          << "\", \"helper\": \"" << results[i].helper
+          << "\", \"assertions\": " << results[i].assertions
+          << ", \"seconds\": " << std::setprecision( 9 ) << results[i].seconds
+          << ", \"ns_per_assertion\": " << std::setprecision( 3 )
+          << results[i].seconds * 1e9 / results[i].assertions
+          << "}" << ( i + 1 < results.size() ? "," : "" ) << "\n";
+   }
+
+   out << "  ]\n}\n";
+
+   std::cout << "\nResults written to " << output << std::endl;
+   return out ? 0 : 1;
+}
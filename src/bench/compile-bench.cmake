@@ -0,0 +1,153 @@
+# Micro Test compile time benchmark, run by the compile_bench target.
+#
+#  cmake -DCXX=compiler -DFLAGS="flags" -DINCLUDE=dir -DBLOCKS=n -DRUNS=n -DOUTPUT=dir -P compile-bench.cmake
+#
+# Generates and compiles four programs: one with just the header and a
+# TestRunner, the same with MICRO_TEST_ALL defined, one with BLOCKS runtime
+# test blocks using a mix of helpers, and one with BLOCKS static_test
+# blocks. The time over the header only program is the cost per test block.
+# After a warm-up compile each program is compiled RUNS times (default 3)
+# and the fastest run is kept, a block cost below the noise is reported as
+# 0. Results are printed and written as JSON to OUTPUT/compile_bench.json.
+
+# TIMESTAMP %f (microseconds) needs 3.23.
+cmake_minimum_required( VERSION 3.23 )
+
+if( NOT BLOCKS )
+   set( BLOCKS 10000 )
+endif()
+
+if( NOT RUNS )
+   set( RUNS 3 )
+endif()
+
+separate_arguments( FLAGS )
+
+set( PROLOGUE "#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include \"micro-test.hpp\"
+" )
+
+# Runtime test blocks cycle through the common helpers and value types.
+set( RUNTIME "${PROLOGUE}
+int main( int argc, const char * argv[] )
+{
+   MicroTest::TestRunner test( argc, argv );
+" )
+set( STATIC "${PROLOGUE}
+constexpr int square( int x )
+{
+   return x * x;
+}
+
+int main( int argc, const char * argv[] )
+{
+   MicroTest::TestRunner test( argc, argv );
+" )
+
+math( EXPR LAST "${BLOCKS} - 1" )
+
+foreach( i RANGE ${LAST} )
+   math( EXPR kind "${i} % 5" )
+
+   if( kind EQUAL 0 )
+      set( check "test.eq( ${i}, ${i} );" )
+   elseif( kind EQUAL 1 )
+      set( check "test.lt( ${i}.0, ${i}.5 );" )
+   elseif( kind EQUAL 2 )
+      set( check "test.eq( std::string( \"${i}\" ), \"${i}\" );" )
+   elseif( kind EQUAL 3 )
+      set( check "test.all( ${i} > 0, true );" )
+   else()
+      set( check "test.ex_none( [] { } );" )
+   endif()
+
+   string( APPEND RUNTIME "   test = \"Block ${i}\";\n   {\n      ${check}\n   }\n" )
+   string( APPEND STATIC "   static_test( \"Block ${i}\", MicroTest::Static::eq( square( ${i} % 1000 ), ( ${i} % 1000 ) * ( ${i} % 1000 ) ) );\n" )
+endforeach()
+
+file( WRITE "${OUTPUT}/compile_bench_header.cpp" "${PROLOGUE}
+int main( int argc, const char * argv[] )
+{
+   MicroTest::TestRunner test( argc, argv );
+}
+" )
+file( WRITE "${OUTPUT}/compile_bench_header_all.cpp" "#define MICRO_TEST_ALL
+${PROLOGUE}
+int main( int argc, const char * argv[] )
+{
+   MicroTest::TestRunner test( argc, argv );
+}
+" )
+file( WRITE "${OUTPUT}/compile_bench_runtime.cpp" "${RUNTIME}}\n" )
+file( WRITE "${OUTPUT}/compile_bench_static.cpp" "${STATIC}}\n" )
+
+# Milliseconds taken to compile one generated file, the fastest of RUNS.
+function( compile_time name result )
+   set( best -1 )
+
+   foreach( run RANGE 1 ${RUNS} )
+      string( TIMESTAMP start "%s%f" UTC )
+      execute_process( COMMAND ${CXX} ${FLAGS} -std=c++11 -I${INCLUDE} -c ${OUTPUT}/compile_bench_${name}.cpp
+                       -o ${OUTPUT}/compile_bench_${name}.o
+                       RESULT_VARIABLE failed )
+      string( TIMESTAMP stop "%s%f" UTC )
+
+      if( failed )
+         message( FATAL_ERROR "compile_bench_${name}.cpp failed to compile" )
+      endif()
+
+      math( EXPR elapsed "( ${stop} - ${start} ) / 1000" )
+
+      if( best LESS 0 OR elapsed LESS best )
+         set( best ${elapsed} )
+      endif()
+   endforeach()
+
+   set( ${result} ${best} PARENT_SCOPE )
+endfunction()
+
+# Microseconds per block over the header only program, 0 when within noise.
+function( block_cost total_ms result )
+   math( EXPR cost "( ${total_ms} - ${header_ms} ) * 1000 / ${BLOCKS}" )
+
+   if( cost LESS 0 )
+      set( cost 0 )
+   endif()
+
+   set( ${result} ${cost} PARENT_SCOPE )
+endfunction()
+
+# The first compile loads the compiler and the system headers from disk.
+execute_process( COMMAND ${CXX} ${FLAGS} -std=c++11 -I${INCLUDE} -c ${OUTPUT}/compile_bench_header.cpp
+                 -o ${OUTPUT}/compile_bench_header.o )
+
+compile_time( header header_ms )
+compile_time( header_all header_all_ms )
+compile_time( runtime runtime_ms )
+compile_time( static static_ms )
+
+block_cost( ${runtime_ms} runtime_us )
+block_cost( ${static_ms} static_us )
+
+message( "Micro Test compile time benchmark, ${BLOCKS} test blocks, best of ${RUNS}\n"
+         "   header only      ${header_ms} ms\n"
+         "   MICRO_TEST_ALL   ${header_all_ms} ms\n"
+         "   runtime blocks   ${runtime_ms} ms, ${runtime_us} us per block\n"
+         "   static blocks    ${static_ms} ms, ${static_us} us per block" )
+
+file( WRITE "${OUTPUT}/compile_bench.json" "{
+  \"blocks\": ${BLOCKS},
+  \"runs\": ${RUNS},
+  \"header_ms\": ${header_ms},
+  \"header_all_ms\": ${header_all_ms},
+  \"runtime_ms\": ${runtime_ms},
+  \"runtime_us_per_block\": ${runtime_us},
+  \"static_ms\": ${static_ms},
+  \"static_us_per_block\": ${static_us}
+}
+" )
@@ -33,15 +33,136 @@
 #include "micro-test.hpp"
 */
 
+// Helpers beyond the equality and exception checks are opt-in, define the
+// macros for them before including Micro Test, the same in every source
+// file of the test program. MICRO_TEST_ALL turns on all of them but fuzz.
+//
+//    MICRO_TEST_PROPERTY  property, MicroTest::Gen
+//    MICRO_TEST_TIMING    complexity, scaling, differential, --bench-env
+//    MICRO_TEST_ROWS      each_row, MicroTest::Row
+//    MICRO_TEST_DEATH     dies, exits
+//    MICRO_TEST_MEMORY    max_rss, -m
+//    MICRO_TEST_REPORTS   --format, --output, --stream, --profile, --repeat
+//    MICRO_TEST_FUZZ      fuzz, in one source file
+#ifdef MICRO_TEST_ALL
+#ifndef MICRO_TEST_PROPERTY
+#define MICRO_TEST_PROPERTY
+#endif
+#ifndef MICRO_TEST_TIMING
+#define MICRO_TEST_TIMING
+#endif
+#ifndef MICRO_TEST_ROWS
+#define MICRO_TEST_ROWS
+#endif
+#ifndef MICRO_TEST_DEATH
+#define MICRO_TEST_DEATH
+#endif
+#ifndef MICRO_TEST_MEMORY
+#define MICRO_TEST_MEMORY
+#endif
+#ifndef MICRO_TEST_REPORTS
+#define MICRO_TEST_REPORTS
+#endif
+#endif
+
+// Headers used by the Micro Test helpers.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined( MICRO_TEST_TIMING ) || defined( MICRO_TEST_ROWS ) || defined( MICRO_TEST_FUZZ )
+#include <algorithm>
+#endif
+
+#ifdef MICRO_TEST_REPORTS
+#include <map>
+#endif
+
+#if defined( MICRO_TEST_PROPERTY ) || defined( MICRO_TEST_TIMING ) || defined( MICRO_TEST_ROWS )
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#endif
+
+#ifdef MICRO_TEST_PROPERTY
+#include <tuple>
+#endif
+
+#if defined( MICRO_TEST_PROPERTY ) || defined( MICRO_TEST_TIMING ) || defined( MICRO_TEST_REPORTS ) || \
+    defined( MICRO_TEST_FUZZ )
+#include <cmath>
+#endif
+
+#ifdef MICRO_TEST_REPORTS
+#include <cctype>
+#endif
+
+// System headers for the Linux and Mac only helpers.
+#if !defined ( _WINDOWS ) && !defined( _WIN32 )
+#define MICRO_TEST_POSIX
+#include <sys/mman.h>
+
+#if defined( MICRO_TEST_REPORTS ) || defined( MICRO_TEST_DEATH ) || defined( MICRO_TEST_FUZZ ) || \
+    defined( MICRO_TEST_ROWS ) || defined( MICRO_TEST_TIMING ) || defined( MICRO_TEST_PROPERTY ) || \
+    defined( MICRO_TEST_MEMORY )
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+#if defined( MICRO_TEST_MEMORY ) || defined( MICRO_TEST_TIMING ) || defined( MICRO_TEST_DEATH ) || \
+    defined( MICRO_TEST_FUZZ )
+#include <sys/resource.h>
+#endif
+
+#ifdef MICRO_TEST_REPORTS
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+#endif
+
+#if defined( __linux__ ) && defined( MICRO_TEST_TIMING )
+#include <sched.h>
+#endif
+
+#if defined( MICRO_TEST_POSIX ) && ( defined( __GLIBC__ ) || defined( __APPLE__ ) )
+#define MICRO_TEST_BACKTRACE
+#include <cxxabi.h>
+#include <execinfo.h>
+#endif
+
+#if defined( MICRO_TEST_MEMORY ) && defined( __GLIBC__ ) && \
+    ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+#define MICRO_TEST_MALLINFO2
+#include <malloc.h>
+#endif
+
 using std::clog;
 
 namespace MicroTest
 {
-   const std::string VERSION( "1.7.0" );
+   const std::string VERSION( "1.8.0" );
 
 #define setup_fixture [&]
 #define cleanup_fixture [&]
 
+// Test a constant expression at compile time, the build stops with
+// i_description when it is false. Nothing is left to run.
+#define static_test( i_description, ... ) static_assert( ( __VA_ARGS__ ), i_description )
+
 #if defined ( _WINDOWS ) || defined( _WIN32 ) || defined( _PLAIN_TEXT )
    const std::string PASS( "Pass: " );
    const std::string FAIL( "FAIL: " );
@@ -52,364 +173,5693 @@ namespace MicroTest
    const std::string WHITE( "\x1B[37m" );
 #endif
 
-   class TestRunner
+   // The test helpers as constexpr functions, for use with static_test.
+   namespace Static
    {
-      enum ReportMode_e { RM_ALL, RM_FAIL, RM_SUMMARY };
+      template <typename T>
+      constexpr bool t( T i_v )
+      {
+         return static_cast<bool>( i_v );
+      }
+      template <typename T>
+      constexpr bool f( T i_v )
+      {
+         return !static_cast<bool>( i_v );
+      }
+      template <typename T>
+      constexpr bool eq( T i_l, T i_r )
+      {
+         return i_l == i_r;
+      }
+      template <typename T>
+      constexpr bool ne( T i_l, T i_r )
+      {
+         return !( i_l == i_r );
+      }
+      template <typename T>
+      constexpr bool lt( T i_l, T i_r )
+      {
+         return i_l < i_r;
+      }
+      template <typename T>
+      constexpr bool gt( T i_l, T i_r )
+      {
+         return i_r < i_l;
+      }
+      template <typename T>
+      constexpr bool le( T i_l, T i_r )
+      {
+         return !( i_r < i_l );
+      }
+      template <typename T>
+      constexpr bool ge( T i_l, T i_r )
+      {
+         return !( i_l < i_r );
+      }
 
-      // RAII fixture helper.
-      class Fixture
+      constexpr bool all()
       {
-         TestRunner * tr;
+         return true;
+      }
+      template <typename T, typename... Args>
+      constexpr bool all( T i_v, Args... i_args )
+      {
+         return static_cast<bool>( i_v ) && all( i_args... );
+      }
+
+      // C strings compare by their characters.
+      constexpr bool eq( const char * const i_s1, const char * const i_s2 )
+      {
+         return *i_s1 == *i_s2 && ( *i_s1 == '\0' || eq( i_s1 + 1, i_s2 + 1 ) );
+      }
+      constexpr bool ne( const char * const i_s1, const char * const i_s2 )
+      {
+         return !eq( i_s1, i_s2 );
+      }
+   } // namespace Static
+
+   // Small and fast random number generator (splitmix64) for generated test
+   // input, usable with the <random> distributions.
+   class Random
+   {
+      uint64_t state;
+
+   public:
+      typedef uint64_t result_type;
+
+      explicit Random( const uint64_t i_seed = 0 ) : state( i_seed )
+      {
+      }
+
+      static constexpr result_type min()
+      {
+         return 0;
+      }
+      static constexpr result_type max()
+      {
+         return ~result_type( 0 );
+      }
+
+      result_type operator()()
+      {
+         return mix( state += 0x9e3779b97f4a7c15ULL );
+      }
+
+      // Generator for item i_index of a sequence, independent of the others.
+      static Random stream( const uint64_t i_seed, const uint64_t i_index )
+      {
+         return Random( mix( i_seed ^ mix( i_index + 0x9e3779b97f4a7c15ULL ) ) );
+      }
+
+      static uint64_t mix( uint64_t i_z )
+      {
+         i_z = ( i_z ^ ( i_z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+         i_z = ( i_z ^ ( i_z >> 27 ) ) * 0x94d049bb133111ebULL;
+         return i_z ^ ( i_z >> 31 );
+      }
+   };
+
+#ifdef MICRO_TEST_PROPERTY
+   // Input generators for TestRunner::property. A generator makes a random
+   // value with operator()( Random & ) and lists simpler values to try when
+   // a value fails with shrink( value ).
+   namespace Gen
+   {
+      template <typename T>
+      class Integer
+      {
+         T low;
+         T high;
 
       public:
-         Fixture( TestRunner * i_testrunner ) : tr( i_testrunner )
+         typedef T value_type;
+
+         Integer( const T i_low, const T i_high ) : low( i_low ), high( i_high )
          {
          }
-         ~Fixture()
+
+         T operator()( Random & io_rng ) const
          {
-            if ( tr->cleanup )
+            // Edges find more bugs than the middle, pick one 1 in 8 times.
+            const uint64_t pick = io_rng();
+
+            if ( pick % 8 == 0 )
             {
-               tr->cleanup();
+               const T edges[] = { low, high, target() };
+               return edges[( pick >> 3 ) % 3];
             }
+
+            const uint64_t range = static_cast<uint64_t>( high ) - static_cast<uint64_t>( low );
+            const uint64_t offset = range == ~uint64_t( 0 ) ? io_rng() : io_rng() % ( range + 1 );
+            return static_cast<T>( static_cast<uint64_t>( low ) + offset );
          }
-      };
 
-      typedef std::function<void()> lambda_t;
+         std::vector<T> shrink( const T & i_value ) const
+         {
+            std::vector<T> simpler;
+            const T goal = target();
 
-      // Test success & fail counts
-      uint32_t pass;
-      uint32_t fail;
+            if ( i_value != goal )
+            {
+               simpler.push_back( goal );
 
-      ReportMode_e report_mode;
+               const T half = static_cast<T>( i_value - ( i_value - goal ) / 2 );
 
-      lambda_t setup;
-      lambda_t cleanup;
+               if ( half != i_value && half != goal )
+               {
+                  simpler.push_back( half );
+               }
 
-      bool test_result;
+               simpler.push_back( static_cast<T>( i_value > goal ? i_value - 1 : i_value + 1 ) );
+            }
 
-      // To capture cerr output
-      std::stringstream err_out;
-      std::streambuf * cerr_buf;
+            return simpler;
+         }
 
-      std::string test_description;
+      private:
+         // Simplest value in range, the one closest to zero.
+         T target() const
+         {
+            return low > 0 ? low : ( high < 0 ? high : T( 0 ) );
+         }
+      };
 
-      void test_status_pass()
+      template <typename T>
+      class Real
       {
-         ++pass;
-         test_result = true;
+         T low;
+         T high;
+
+      public:
+         typedef T value_type;
 
-         if ( report_mode < RM_FAIL )
+         Real( const T i_low, const T i_high ) : low( i_low ), high( i_high )
          {
-            clog << PASS
-                 << test_description
-                 << WHITE
-                 << std::endl;
          }
-      }
 
-      void test_status_fail()
-      {
-         ++fail;
-         test_result = false;
+         T operator()( Random & io_rng ) const
+         {
+            // 53 random bits as a fraction in [0, 1).
+            const double fraction = static_cast<double>( io_rng() >> 11 ) * ( 1.0 / 9007199254740992.0 );
+            return low + static_cast<T>( fraction * ( high - low ) );
+         }
 
-         if ( report_mode < RM_SUMMARY )
-            clog << FAIL
-                 << test_description
-                 << WHITE
-                 << std::endl;
-      }
+         std::vector<T> shrink( const T & i_value ) const
+         {
+            std::vector<T> simpler;
+            const T goal = low > 0 ? low : ( high < 0 ? high : T( 0 ) );
+            const T whole = std::trunc( i_value );
 
-      void check( const bool i_status )
+            if ( i_value != goal )
+            {
+               simpler.push_back( goal );
+
+               if ( whole != i_value && whole >= low && whole <= high )
+               {
+                  simpler.push_back( whole );
+               }
+
+               const T half = goal + ( i_value - goal ) / 2;
+
+               if ( half != i_value && half != goal )
+               {
+                  simpler.push_back( half );
+               }
+            }
+
+            return simpler;
+         }
+      };
+
+      // Printable ASCII strings up to max_length characters.
+      class String
       {
-         Fixture fix( this );
+         std::size_t max_length;
 
-         if ( i_status )
+      public:
+         typedef std::string value_type;
+
+         explicit String( const std::size_t i_max_length ) : max_length( i_max_length )
          {
-            test_status_pass();
          }
-         else
+
+         std::string operator()( Random & io_rng ) const
          {
-            test_status_fail();
-         }
+            std::string text( io_rng() % ( max_length + 1 ), ' ' );
 
-         // Clear error buffer & error states
-         err_out.str( "" );
-         err_out.clear();
-      }
+            for ( std::size_t i = 0; i < text.size(); ++i )
+            {
+               text[i] = static_cast<char>( ' ' + io_rng() % 95 );
+            }
 
-      void program_arguments( const int i_argc, const char * const i_argv[] )
-      {
-         if ( i_argc < 2 )
-         {
-            report_mode = RM_ALL;
-            return;
+            return text;
          }
 
-         switch ( i_argv[1][1] )
+         std::vector<std::string> shrink( const std::string & i_value ) const
          {
-         case 'a':
-            report_mode = RM_ALL;
-            break;
+            std::vector<std::string> simpler;
 
-         case 'f':
-            report_mode = RM_FAIL;
-            break;
+            if ( i_value.empty() )
+            {
+               return simpler;
+            }
 
-         case 's':
-            report_mode = RM_SUMMARY;
-            break;
+            simpler.push_back( "" );
+            simpler.push_back( i_value.substr( 0, i_value.size() / 2 ) );
+            simpler.push_back( i_value.substr( i_value.size() / 2 ) );
 
-         default:
-            std::cout << "\nMicro Test Usage\n"
-                      << "================\n\n"
-                      << i_argv[0] << " [OPTIONS]\n\n"
-                      << "OPTIONS\n"
-                      << "   <blank>  No arguments passed, show all test results.\n"
-                      << "   -a       Show all test results.\n"
-                      << "   -f       Show only failing results.\n"
-                      << "   -s       Show only the summary report.\n"
-                      << "   -h       Output this usage message and exit.\n\n";
-            std::exit( 1 );
-         } // switch
-      }
+            for ( std::size_t i = 0; i < i_value.size(); ++i )
+            {
+               simpler.push_back( std::string( i_value ).erase( i, 1 ) );
+            }
 
-      template <typename TEX>
-      void exception( const lambda_t i_fn,
-                      const bool i_exception_expected = true )
-      {
-         bool exception_thrown = false;
-         Fixture fix( this );
+            for ( std::size_t i = 0; i < i_value.size(); ++i )
+            {
+               if ( i_value[i] != 'a' )
+               {
+                  std::string plain( i_value );
+                  plain[i] = 'a';
+                  simpler.push_back( plain );
+               }
+            }
 
-         try
-         {
-            i_fn();
-            exception_thrown = false;
-         }
-         catch ( TEX & ex )
-         {
-            exception_thrown = true;
+            return simpler;
          }
-         catch ( ... )
+      };
+
+      // Vectors of up to max_length elements made by an element generator.
+      template <typename G>
+      class Vector
+      {
+         G element;
+         std::size_t max_length;
+
+      public:
+         typedef std::vector<typename G::value_type> value_type;
+
+         Vector( const G & i_element, const std::size_t i_max_length )
+            : element( i_element ), max_length( i_max_length )
          {
-            // Not the exception tested for.
-            exception_thrown = false;
          }
 
-         if ( ( exception_thrown && i_exception_expected ) ||
-              ( !exception_thrown && !i_exception_expected ) )
+         value_type operator()( Random & io_rng ) const
          {
-            test_status_pass();
+            value_type values;
+            const std::size_t length = io_rng() % ( max_length + 1 );
+
+            for ( std::size_t i = 0; i < length; ++i )
+            {
+               values.push_back( element( io_rng ) );
+            }
+
+            return values;
          }
-         else
+
+         std::vector<value_type> shrink( const value_type & i_value ) const
          {
-            test_status_fail();
+            std::vector<value_type> simpler;
+
+            if ( i_value.empty() )
+            {
+               return simpler;
+            }
+
+            const std::size_t half = i_value.size() / 2;
+            simpler.push_back( value_type() );
+            simpler.push_back( value_type( i_value.begin(), i_value.begin() + half ) );
+            simpler.push_back( value_type( i_value.begin() + half, i_value.end() ) );
+
+            for ( std::size_t i = 0; i < i_value.size(); ++i )
+            {
+               value_type fewer( i_value );
+               fewer.erase( fewer.begin() + i );
+               simpler.push_back( fewer );
+            }
+
+            for ( std::size_t i = 0; i < i_value.size(); ++i )
+            {
+               const std::vector<typename G::value_type> smaller = element.shrink( i_value[i] );
+
+               if ( !smaller.empty() )
+               {
+                  value_type changed( i_value );
+                  changed[i] = smaller[0];
+                  simpler.push_back( changed );
+               }
+            }
+
+            return simpler;
          }
+      };
 
-         // Clear error buffer & error states
-         err_out.str( "" );
-         err_out.clear();
+      template <typename T>
+      Integer<T> integer( const T i_low = std::numeric_limits<T>::min(),
+                          const T i_high = std::numeric_limits<T>::max() )
+      {
+         return Integer<T>( i_low, i_high );
       }
 
-   public:
-      explicit TestRunner( const int i_argc = 1,
-                           const char * const i_argv[] = nullptr )
-         : pass{}
-         , fail{}
-         , setup{}
-         , cleanup{}
+      template <typename T>
+      Real<T> real( const T i_low, const T i_high )
       {
-         program_arguments( i_argc, i_argv );
-
-         // Capture cerr, don't want test output polluted.
-         cerr_buf = std::cerr.rdbuf( err_out.rdbuf() );
-         clog << "\no=================================================o\n"
-              << "| Micro Test v" << VERSION << " for C/C++                     |\n"
-              << "|                                                 |\n"
-              << "| https://bitbucket.org/rajinder_yadav/micro_test |\n"
-              << "o=================================================o"
-              << std::endl;
+         return Real<T>( i_low, i_high );
       }
 
-      virtual ~TestRunner()
+      inline String string( const std::size_t i_max_length = 32 )
       {
-         clog << "==============================================\n";
-         clog << "Test Summary: Tests(" << pass + fail << ") "
-              << "Passed(" << pass << ") "
-              << "Failed(" << fail << ")\n" << std::endl;
-         // Restore cerr
-         std::cerr.rdbuf( cerr_buf );
+         return String( i_max_length );
       }
 
-      void should_pass() const
+      template <typename G>
+      Vector<G> vector( const G & i_element, const std::size_t i_max_length = 32 )
       {
-         if ( test_result == false )
-         {
-            clog << "Error! Unexpected test result!" << std::endl;
-            std::exit( 1 );
-         }
+         return Vector<G>( i_element, i_max_length );
       }
-      void should_fail() const
+   } // namespace Gen
+#endif
+
+#if defined( MICRO_TEST_POSIX ) && defined( MICRO_TEST_FUZZ )
+// Keeps the fuzzer's own code out of the coverage it measures.
+#if defined( __clang__ )
+#define MICRO_TEST_NO_COVERAGE __attribute__(( no_sanitize( "coverage" ) ))
+#elif defined( __GNUC__ ) && __GNUC__ >= 12
+#define MICRO_TEST_NO_COVERAGE __attribute__(( no_sanitize_coverage ))
+#else
+#define MICRO_TEST_NO_COVERAGE
+#endif
+
+   // Edge hit counts for TestRunner::fuzz, filled in when the code under
+   // test is built with -fsanitize-coverage=trace-pc-guard (clang) or
+   // -fsanitize-coverage=trace-pc (gcc). All zero otherwise.
+   struct Coverage
+   {
+      enum { SIZE = 1 << 14 };
+
+      MICRO_TEST_NO_COVERAGE static uint8_t * counters()
       {
-         if ( test_result == true )
+         static uint8_t hits[SIZE];
+         return hits;
+      }
+
+      // Last block run, trace-pc reports blocks and edges are made from pairs.
+      MICRO_TEST_NO_COVERAGE static uint64_t & previous()
+      {
+         static uint64_t block;
+         return block;
+      }
+   };
+
+   // Instrumentation callbacks, weak so a sanitizer or libFuzzer runtime
+   // linked into the program takes precedence.
+   extern "C" __attribute__(( weak )) MICRO_TEST_NO_COVERAGE
+   void __sanitizer_cov_trace_pc_guard_init( uint32_t * io_start, uint32_t * io_stop )
+   {
+      static uint32_t edges;
+
+      if ( io_start == io_stop || *io_start )
+      {
+         return;
+      }
+
+      for ( uint32_t * guard = io_start; guard < io_stop; ++guard )
+      {
+         *guard = ++edges;
+      }
+   }
+
+   extern "C" __attribute__(( weak )) MICRO_TEST_NO_COVERAGE
+   void __sanitizer_cov_trace_pc_guard( uint32_t * i_guard )
+   {
+      ++Coverage::counters()[*i_guard & ( Coverage::SIZE - 1 )];
+   }
+
+   extern "C" __attribute__(( weak )) MICRO_TEST_NO_COVERAGE
+   void __sanitizer_cov_trace_pc()
+   {
+      const uint64_t block = ( reinterpret_cast<uintptr_t>( __builtin_return_address( 0 ) )
+                               * 0x9e3779b97f4a7c15ULL ) >> 40;
+      uint64_t & previous = Coverage::previous();
+
+      ++Coverage::counters()[( block ^ previous ) & ( Coverage::SIZE - 1 )];
+      previous = block >> 1;
+   }
+#endif
+
+#if defined( MICRO_TEST_BACKTRACE ) && ( defined( MICRO_TEST_REPORTS ) || defined( MICRO_TEST_LEAK_CHECK ) )
+   // Function name for a return address, or module+offset when unknown.
+   inline std::string frame_name( void * i_address )
+   {
+      char ** symbols = backtrace_symbols( &i_address, 1 );
+
+      if ( !symbols )
+      {
+         return "??";
+      }
+
+      // Format is "module(function+offset) [address]".
+      const std::string symbol( symbols[0] );
+      std::free( symbols );
+
+      const std::size_t open = symbol.find( '(' );
+      const std::size_t plus = symbol.find( '+', open );
+      std::string name;
+
+      if ( open != std::string::npos && plus != std::string::npos && plus > open + 1 )
+      {
+         const std::string mangled = symbol.substr( open + 1, plus - open - 1 );
+         int status = 0;
+         char * demangled = abi::__cxa_demangle( mangled.c_str(), nullptr, nullptr, &status );
+         name = ( status == 0 && demangled ) ? demangled : mangled;
+         std::free( demangled );
+      }
+      else
+      {
+         const std::size_t slash = symbol.rfind( '/', open );
+         const std::size_t close = symbol.find( ')', open );
+         const std::size_t start = slash == std::string::npos ? 0 : slash + 1;
+         name = symbol.substr( start, open - start );
+
+         if ( close != std::string::npos && open != std::string::npos )
          {
-            clog << "Error! Unexpected test result!" << std::endl;
-            std::exit( 1 );
+            name += symbol.substr( open + 1, close - open - 1 );
          }
       }
 
-      void operator=( const std::string & i_message )
+      // ';' separates frames in the folded format.
+      for ( std::size_t i = 0; i < name.size(); ++i )
       {
-         if ( setup )
+         if ( name[i] == ';' )
          {
-            setup();
+            name[i] = ':';
          }
-
-         test_description = i_message;
       }
 
-      void operator()( const bool i_flag )
+      return name;
+   }
+#endif
+
+   // Live heap blocks for the leak checker, kept by the operator new and
+   // delete defined with MICRO_TEST_LEAK_CHECK. Blocks are recorded in a
+   // lock-free open addressing table mapped outside the heap, with their
+   // size, the test that allocated them and their allocation stack, which
+   // is kept once in a second table. A per-test count of live blocks means
+   // the table is only scanned when a test leaks. A test's leaks are looked
+   // for once the next test has started, after the description given to it
+   // is freed, so the blocks of two tests are counted.
+   class Leaks
+   {
+   public:
+      enum { SLOTS = 1 << 21, STACKS = 1 << 16, PROBES = 64, DEPTH = 8 };
+      enum { EMPTY = 0, REMOVED = 1, BUSY = 2 };
+
+      // The fields are written while the key is BUSY and published by the
+      // release store of the block address, a reader loading the address
+      // with acquire sees them. They are atomic as a report may still read
+      // them when a later block takes the slot.
+      struct Slot_t
       {
-         check( i_flag );
-      }
+         std::atomic<uintptr_t> key;  // Block address, or EMPTY, REMOVED or BUSY.
+         std::atomic<std::size_t> size;
+         std::atomic<uint32_t> test;
+         std::atomic<uint32_t> stack;  // Index in the stack table from 1, 0 for none.
+      };
 
-      void fixture( const lambda_t i_setup = nullptr,
-                    const lambda_t i_cleanup = nullptr )
+      // Return addresses of an allocation, from the caller of operator new.
+      struct Stack_t
       {
-         setup = i_setup;
-         cleanup = i_cleanup;
-      }
+         std::atomic<uint64_t> hash;  // 0 for an unused entry.
+         std::atomic<int> depth;      // Set once the frames are written.
+         void * frames[DEPTH];
+      };
 
-      //======================
-      // Equality Test Helper
-      //======================
-      template <typename T>
-      void t( T i_v )
+      struct State_t
       {
-         check( i_v == true );
+         std::atomic<Slot_t *> slots;
+         std::atomic<Stack_t *> stacks;
+         std::atomic<uint32_t> test;       // Test being tracked, 0 for none.
+         std::atomic<uint32_t> settling;   // Test before it, 0 when settled.
+         std::atomic<uint32_t> tests;
+         std::atomic<long long> blocks;    // Live blocks of the test being tracked.
+         std::atomic<long long> settling_blocks;
+         std::atomic<long long> entries;   // Blocks recorded in the table.
+         std::atomic<long long> removed;   // REMOVED entries in the table.
+         std::atomic<long long> untracked; // Blocks not recorded, the table was full.
+         std::atomic<bool> installed;
+         std::string ( *report )( uint32_t );  // Note on the live blocks of a test.
+      };
+
+      // Framework internals allocating memory that outlives a test pause
+      // tracking.
+      class Pause
+      {
+      public:
+         Pause()
+         {
+            ++paused();
+         }
+         ~Pause()
+         {
+            --paused();
+         }
+      };
+
+      static State_t & state()
+      {
+         static State_t instance;
+         return instance;
       }
-      template <typename T>
-      void f( T i_v )
+
+      static int & paused()
       {
-         check( i_v == false );
+         static thread_local int depth;
+         return depth;
       }
-      template <typename T>
-      void eq( T i_l, T i_r )
+
+      static bool installed()
       {
-         check( i_l == i_r );
+         return state().installed;
       }
-      template <typename T>
-      void ne( T i_l, T i_r )
+
+      // Allocations on this thread are recorded.
+      static bool tracking()
       {
-         check( i_l != i_r );
+         return state().test.load( std::memory_order_relaxed ) != 0 && !paused();
       }
-      template <typename T>
-      void lt( T i_l, T i_r )
+
+      static std::size_t slot( const uintptr_t i_key )
       {
-         check( i_l < i_r );
+         return static_cast<std::size_t>( ( ( i_key >> 4 ) * 0x9e3779b97f4a7c15ULL ) >> 43 );
       }
-      template <typename T>
-      void gt( T i_l, T i_r )
+
+      static Slot_t * table()
       {
-         check( i_l > i_r );
+         return mapped( state().slots, SLOTS );
       }
-      template <typename T>
-      void le( T i_l, T i_r )
+
+      static Stack_t * stacks()
       {
-         check( i_l <= i_r );
+         return mapped( state().stacks, STACKS );
       }
-      template <typename T>
-      void ge( T i_l, T i_r )
+
+      // Index from 1 of the stack of i_depth frames, added when new, or 0
+      // when the stack table is full.
+      static uint32_t intern( void * const * i_frames, const int i_depth )
       {
-         check( i_l >= i_r );
+         Stack_t * const table = stacks();
+         uint64_t hash = 0xcbf29ce484222325ULL;
+
+         for ( int i = 0; i < i_depth; ++i )
+         {
+            hash = ( hash ^ reinterpret_cast<uintptr_t>( i_frames[i] ) ) * 0x100000001b3ULL;
+         }
+
+         hash |= 1;
+         const std::size_t first = static_cast<std::size_t>( hash >> 48 );
+
+         for ( std::size_t i = 0; table && i < PROBES; ++i )
+         {
+            const std::size_t index = ( first + i ) & ( STACKS - 1 );
+            Stack_t & entry = table[index];
+            uint64_t old = entry.hash.load( std::memory_order_acquire );
+
+            if ( old == 0 && entry.hash.compare_exchange_strong( old, hash ) )
+            {
+               std::memcpy( entry.frames, i_frames, i_depth * sizeof( void * ) );
+               entry.depth.store( i_depth, std::memory_order_release );
+               return static_cast<uint32_t>( index + 1 );
+            }
+
+            if ( old == hash )
+            {
+               return static_cast<uint32_t>( index + 1 );
+            }
+         }
+
+         return 0;
       }
 
-      template <typename... Args>
-      void all( Args... i_args )
+      static void add( void * const i_block, const std::size_t i_size, const uint32_t i_stack )
       {
-         const int size = sizeof...( i_args );
-         bool status[size] = {i_args...};
+         State_t & s = state();
+         const uint32_t test = s.test.load( std::memory_order_relaxed );
 
-         for ( int i = 0; i < size; ++i )
+         if ( !i_block || !test )
          {
-            if ( !status[i] )
+            return;
+         }
+
+         Slot_t * const slots = table();
+         const uintptr_t key = reinterpret_cast<uintptr_t>( i_block );
+         const std::size_t first = slot( key );
+
+         for ( std::size_t i = 0; slots && i < PROBES; ++i )
+         {
+            Slot_t & entry = slots[( first + i ) & ( SLOTS - 1 )];
+            uintptr_t old = entry.key.load( std::memory_order_relaxed );
+
+            if ( old <= REMOVED && entry.key.compare_exchange_strong( old, BUSY ) )
             {
-               check( false );
+               if ( old == REMOVED )
+               {
+                  --s.removed;
+               }
+
+               entry.size.store( i_size, std::memory_order_relaxed );
+               entry.test.store( test, std::memory_order_relaxed );
+               entry.stack.store( i_stack, std::memory_order_relaxed );
+               entry.key.store( key, std::memory_order_release );
+               ++s.entries;
+               ++s.blocks;
                return;
             }
          }
 
-         check( true );
+         ++s.untracked;
       }
 
-      //==========================
-      // String Comparison Helpers
-      //==========================
-      void eq( const std::string & i_s1, const std::string & i_s2 )
+      static void remove( void * const i_block )
       {
-         check( i_s1.compare( i_s2 ) == 0 );
+         State_t & s = state();
+         Slot_t * const slots = s.slots.load( std::memory_order_acquire );
+         const uintptr_t key = reinterpret_cast<uintptr_t>( i_block );
+
+         if ( !slots || !i_block )
+         {
+            return;
+         }
+
+         const std::size_t first = slot( key );
+
+         for ( std::size_t i = 0; i < PROBES; ++i )
+         {
+            Slot_t & entry = slots[( first + i ) & ( SLOTS - 1 )];
+            const uintptr_t old = entry.key.load( std::memory_order_acquire );
+
+            if ( old == EMPTY )
+            {
+               return;
+            }
+
+            if ( old == key )
+            {
+               const uint32_t test = entry.test.load( std::memory_order_relaxed );
+
+               if ( test == s.test.load( std::memory_order_relaxed ) )
+               {
+                  --s.blocks;
+               }
+               else if ( test == s.settling.load( std::memory_order_relaxed ) )
+               {
+                  --s.settling_blocks;
+               }
+
+               entry.key.store( REMOVED, std::memory_order_release );
+               --s.entries;
+               ++s.removed;
+               return;
+            }
+         }
       }
-      void eq( const char * const i_s1, const char * const i_s2 )
+
+      // Start a new test, tracked or not. The test before it is settled
+      // next, settle() must have been called for the one before that.
+      static void begin( const bool i_track )
       {
-         check( std::string( i_s1 ).compare( i_s2 ) == 0 );
+         State_t & s = state();
+         s.settling_blocks = s.blocks.load();
+         s.settling = s.test.load();
+         s.blocks = 0;
+         s.test = i_track ? ++s.tests : 0;
       }
-      void ne( const std::string & i_s1, const std::string & i_s2 )
+
+      // The test before the current one, 0 for none or one not tracked, and
+      // if it has live blocks. Its blocks are no longer counted after.
+      static uint32_t settle( bool & o_live )
       {
-         check( i_s1.compare( i_s2 ) != 0 );
+         State_t & s = state();
+         const uint32_t test = s.settling.exchange( 0 );
+         o_live = test && s.settling_blocks > 0;
+         return test;
       }
-      void ne( const char * const i_s1, const char * const i_s2 )
+
+      // Take a reported block out of the table.
+      static void forget( Slot_t & io_entry )
       {
-         check( std::string( i_s1 ).compare( i_s2 ) != 0 );
+         io_entry.key.store( REMOVED, std::memory_order_release );
+         --state().entries;
+         ++state().removed;
       }
 
-      //======================
-      // Exception Test Helper
-      //======================
-
-      // Test exception T is thrown.
-      template <typename T>
-      void ex( const lambda_t i_fn )
+      // Once a quarter of the table holds REMOVED entries and no block is
+      // recorded in it, it is made empty again, so frees don't probe past
+      // the entries of earlier tests.
+      static void sweep()
       {
-         exception<T>( i_fn, true );
+         State_t & s = state();
+         Slot_t * const slots = s.slots.load( std::memory_order_acquire );
+
+         if ( !slots || s.removed < SLOTS / 4 || s.entries > 0 )
+         {
+            return;
+         }
+
+#if defined( __linux__ ) && defined( MADV_DONTNEED )
+         // Pages are given back and read as zero again.
+         madvise( slots, SLOTS * sizeof( Slot_t ), MADV_DONTNEED );
+#else
+         std::memset( static_cast<void *>( slots ), 0, SLOTS * sizeof( Slot_t ) );
+#endif
+         s.removed = 0;
       }
-      // Test exception T is never thrown.
+
+   private:
+      // A table of i_count zeroed T, mapped on first use.
       template <typename T>
-      void ex_not( const lambda_t i_fn )
+      static T * mapped( std::atomic<T *> & io_table, const std::size_t i_count )
       {
-         exception<T>( i_fn, false );
+         T * table = io_table.load( std::memory_order_acquire );
+
+         if ( table )
+         {
+            return table;
+         }
+
+#ifdef MICRO_TEST_POSIX
+#ifdef MAP_NORESERVE
+         const int flags = MAP_PRIVATE | MAP_ANON | MAP_NORESERVE;
+#else
+         const int flags = MAP_PRIVATE | MAP_ANON;
+#endif
+         void * const memory = mmap( nullptr, i_count * sizeof( T ), PROT_READ | PROT_WRITE, flags, -1, 0 );
+
+         if ( memory == MAP_FAILED )
+         {
+            return nullptr;
+         }
+
+         if ( !io_table.compare_exchange_strong( table, static_cast<T *>( memory ) ) )
+         {
+            munmap( memory, i_count * sizeof( T ) );
+            return table;
+         }
+
+         return static_cast<T *>( memory );
+#else
+         return nullptr;
+#endif
       }
-      // Test any exception is thrown.
-      void ex_any( const lambda_t i_fn )
+   };
+
+   // Outcome of every check made by a TestRunner. Results are stored column
+   // wise in fixed size blocks, 5 bytes per check and 4 more for its time
+   // when checks are timed, so earlier results never move. A test with the
+   // same description as the one before it shares its text.
+   class ResultTable
+   {
+      enum { BLOCK_SIZE = 16384 };
+
+      struct Block_t
       {
-         Fixture fix( this );
+         uint32_t test[BLOCK_SIZE];
+         uint8_t passed[BLOCK_SIZE];
+         float * ms;  // Made on the first timed check.
 
-         try
+         Block_t() : ms{}
          {
-            i_fn();
-            test_status_fail();
          }
-         catch ( ... )
+         ~Block_t()
          {
-            test_status_pass();
+            delete[] ms;
          }
-      }
-      // Test no exception is ever thrown of any type.
-      void ex_none( const lambda_t i_fn )
+      };
+
+      std::vector<Block_t *> blocks;
+      Block_t * last;  // Block being filled.
+      std::size_t count;
+
+      std::vector<uint32_t> test_text;  // Description of each test.
+      std::vector<std::string> texts;
+
+      // Notes by row, in row order.
+      std::vector<std::pair<std::size_t, std::string> > notes;
+
+      // First note at or after row i_row.
+      std::size_t note_at( const std::size_t i_row ) const
       {
-         Fixture fix( this );
+         std::size_t first = 0;
+         std::size_t end = notes.size();
 
-         try
+         while ( first < end )
          {
-            i_fn();
-            test_status_pass();
+            const std::size_t middle = first + ( end - first ) / 2;
+
+            if ( notes[middle].first < i_row )
+            {
+               first = middle + 1;
+            }
+            else
+            {
+               end = middle;
+            }
          }
-         catch ( ... )
+
+         return first;
+      }
+
+      ResultTable( const ResultTable & ) = delete;
+      ResultTable & operator=( const ResultTable & ) = delete;
+
+   public:
+      ResultTable() : last{}, count{}, texts( 1 )
+      {
+         add_test( "" );
+      }
+      ~ResultTable()
+      {
+         for ( std::size_t i = 0; i < blocks.size(); ++i )
          {
-            test_status_fail();
+            delete blocks[i];
          }
       }
-   };
 
-} // namespace MicroTest
+      // Start a new test, returns its index.
+      uint32_t add_test( const std::string & i_description )
+      {
+         // Tests in a loop repeat one description.
+         if ( texts.back() != i_description )
+         {
+            texts.push_back( i_description );
+         }
+
+         test_text.push_back( static_cast<uint32_t>( texts.size() - 1 ) );
+         return static_cast<uint32_t>( test_text.size() - 1 );
+      }
+
+      // Record a check of test i_test, returns its row.
+      std::size_t add( const uint32_t i_test, const bool i_passed, const float i_ms )
+      {
+         const std::size_t offset = count % BLOCK_SIZE;
+
+         if ( offset == 0 )
+         {
+            blocks.push_back( nullptr );
+            last = blocks.back() = new Block_t;
+         }
+
+         Block_t & block = *last;
+         block.test[offset] = i_test;
+         block.passed[offset] = i_passed;
+
+         if ( i_ms != 0 )
+         {
+            if ( !block.ms )
+            {
+               block.ms = new float[BLOCK_SIZE]();
+            }
+
+            block.ms[offset] = i_ms;
+         }
+
+         return count++;
+      }
+
+      void set_note( const std::size_t i_row, const std::string & i_note )
+      {
+         // Notes come with the newest row, append without a search.
+         const std::size_t at = notes.empty() || notes.back().first < i_row ? notes.size() : note_at( i_row );
+
+         if ( at < notes.size() && notes[at].first == i_row )
+         {
+            notes[at].second = i_note;
+         }
+         else
+         {
+            notes.insert( notes.begin() + at, std::make_pair( i_row, i_note ) );
+         }
+      }
+
+      std::size_t size() const
+      {
+         return count;
+      }
+      uint32_t test( const std::size_t i_row ) const
+      {
+         return blocks[i_row / BLOCK_SIZE]->test[i_row % BLOCK_SIZE];
+      }
+      bool passed( const std::size_t i_row ) const
+      {
+         return blocks[i_row / BLOCK_SIZE]->passed[i_row % BLOCK_SIZE] != 0;
+      }
+      void set_passed( const std::size_t i_row, const bool i_passed )
+      {
+         blocks[i_row / BLOCK_SIZE]->passed[i_row % BLOCK_SIZE] = i_passed;
+      }
+      float ms( const std::size_t i_row ) const
+      {
+         const Block_t & block = *blocks[i_row / BLOCK_SIZE];
+         return block.ms ? block.ms[i_row % BLOCK_SIZE] : 0;
+      }
+      const std::string & description( const std::size_t i_row ) const
+      {
+         return texts[test_text[test( i_row )]];
+      }
+      // Extra detail reported with a result, empty when there is none.
+      const std::string & note( const std::size_t i_row ) const
+      {
+         static const std::string none;
+         const std::size_t at = note_at( i_row );
+         return at < notes.size() && notes[at].first == i_row ? notes[at].second : none;
+      }
+   };
+
+#ifdef MICRO_TEST_ROWS
+   // One field of a Row, a view into the data file.
+   class Field
+   {
+      const char * first;
+      const char * last;
+
+   public:
+      Field( const char * i_first, const char * i_last ) : first( i_first ), last( i_last )
+      {
+      }
+
+      bool empty() const
+      {
+         return first == last;
+      }
+
+      // Field text, a quoted field without its quotes and with "" as ".
+      std::string str() const
+      {
+         if ( first == last || *first != '"' )
+         {
+            return std::string( first, last );
+         }
+
+         std::string text;
+
+         for ( const char * c = first + 1; c < last; ++c )
+         {
+            if ( *c == '"' && ( ++c == last || *c != '"' ) )
+            {
+               break;
+            }
+
+            text += *c;
+         }
+
+         return text;
+      }
+
+      // The decimal number in the field, a field of 32 characters or more
+      // throws std::out_of_range and one that is not all number throws
+      // std::invalid_argument.
+      long long as_int() const
+      {
+         char text[32];
+         char * end = nullptr;
+         const long long value = std::strtoll( terminated( text, sizeof text ), &end, 10 );
+         whole( text, end );
+         return value;
+      }
+
+      // The number in the field, a field of 64 characters or more throws
+      // std::out_of_range and one that is not all number throws
+      // std::invalid_argument.
+      double as_double() const
+      {
+         char text[64];
+         char * end = nullptr;
+         const double value = std::strtod( terminated( text, sizeof text ), &end );
+         whole( text, end );
+         return value;
+      }
+
+      bool operator==( const std::string & i_text ) const
+      {
+         return str() == i_text;
+      }
+
+   private:
+      // Copy into o_text as a C string without quotes, numbers are short.
+      const char * terminated( char * o_text, const std::size_t i_size ) const
+      {
+         std::size_t length = 0;
+
+         for ( const char * c = first; c < last; ++c )
+         {
+            if ( *c == '"' )
+            {
+               continue;
+            }
+
+            if ( length + 1 == i_size )
+            {
+               throw std::out_of_range( "MicroTest::Field too long for a number" );
+            }
+
+            o_text[length++] = *c;
+         }
+
+         o_text[length] = '\0';
+         return o_text;
+      }
+
+      // Throw unless i_end, where the number stopped, is the end of i_text.
+      static void whole( const char * i_text, const char * i_end )
+      {
+         if ( i_end == i_text || *i_end != '\0' )
+         {
+            throw std::invalid_argument( "MicroTest::Field not a number" );
+         }
+      }
+   };
+
+   // One line of a CSV file given to TestRunner::each_row. Fields are only
+   // split out when first asked for, and the storage for them is reused
+   // from row to row. A quoted field can't span lines, a row with a quote
+   // left open at the end of its line throws std::runtime_error when a
+   // field is asked for.
+   class Row
+   {
+      friend class TestRunner;
+
+      const char * first;
+      const char * last;
+      std::size_t number;
+      char delimiter;
+      mutable bool split;
+      mutable bool unterminated;
+      mutable std::vector<const char *> bounds;  // Start of each field, then the end.
+
+      void assign( const char * i_first, const char * i_last, const std::size_t i_number )
+      {
+         first = i_first;
+         last = i_last;
+         number = i_number;
+         split = false;
+      }
+
+      void split_fields() const
+      {
+         bounds.clear();
+         unterminated = false;
+         const char * c = first;
+
+         for ( ;; )
+         {
+            bounds.push_back( c );
+
+            if ( c < last && *c == '"' )
+            {
+               // Quoted, the delimiter may appear inside.
+               unterminated = true;
+
+               for ( ++c; c < last; ++c )
+               {
+                  if ( *c == '"' && ( c + 1 == last || c[1] != '"' ) )
+                  {
+                     ++c;
+                     unterminated = false;
+                     break;
+                  }
+
+                  c += *c == '"';  // "" is a quote inside the field.
+               }
+
+               if ( unterminated )
+               {
+                  break;
+               }
+            }
+
+            const char * const next = static_cast<const char *>(
+                                         std::memchr( c, delimiter, static_cast<std::size_t>( last - c ) ) );
+
+            if ( !next )
+            {
+               break;
+            }
+
+            c = next + 1;
+         }
+
+         bounds.push_back( last + 1 );
+         split = true;
+      }
+
+   public:
+      explicit Row( const char i_delimiter = ',' )
+         : first{}, last{}, number{}, delimiter( i_delimiter ), split{}, unterminated{}
+      {
+      }
+
+      // Line number in the file, from 1.
+      std::size_t line() const
+      {
+         return number;
+      }
+
+      // The whole line.
+      std::string str() const
+      {
+         return std::string( first, last );
+      }
+
+      std::size_t size() const
+      {
+         if ( !split )
+         {
+            split_fields();
+         }
+
+         return bounds.size() - 1;
+      }
+
+      Field operator[]( const std::size_t i_index ) const
+      {
+         if ( i_index >= size() )
+         {
+            throw std::out_of_range( "MicroTest::Row field index" );
+         }
+
+         if ( unterminated )
+         {
+            throw std::runtime_error( "MicroTest::Row quoted field not closed on its line" );
+         }
+
+         return Field( bounds[i_index], bounds[i_index + 1] - 1 );
+      }
+   };
+#endif
+
+   class TestRunner
+   {
+      enum ReportMode_e { RM_ALL, RM_FAIL, RM_SUMMARY };
+
+      static const std::size_t NO_ROW = ~static_cast<std::size_t>( 0 );
+
+      // RAII fixture helper.
+      class Fixture
+      {
+         TestRunner * tr;
+
+      public:
+         Fixture( TestRunner * i_testrunner ) : tr( i_testrunner )
+         {
+         }
+         ~Fixture()
+         {
+            if ( tr->cleanup )
+            {
+               tr->cleanup();
+            }
+         }
+      };
+
+      // Captured cerr output, kept from test to test, so its buffer growing
+      // is not a leak of the test writing.
+      class ErrorBuffer : public std::stringbuf
+      {
+      protected:
+         int_type overflow( const int_type i_c ) override
+         {
+            const Leaks::Pause pause;
+            return std::stringbuf::overflow( i_c );
+         }
+         std::streamsize xsputn( const char_type * i_text, const std::streamsize i_size ) override
+         {
+            const Leaks::Pause pause;
+            return std::stringbuf::xsputn( i_text, i_size );
+         }
+      };
+
+      typedef std::function<void()> lambda_t;
+#ifdef MICRO_TEST_TIMING
+      typedef std::function<void( std::size_t )> size_lambda_t;
+      typedef std::function<void( unsigned )> thread_lambda_t;
+#endif
+#ifdef MICRO_TEST_FUZZ
+      typedef std::function<void( const uint8_t *, std::size_t )> fuzz_lambda_t;
+#endif
+
+      // Test success & fail counts
+      uint32_t pass;
+      uint32_t fail;
+
+      ReportMode_e report_mode;
+
+      // Report memory usage with each test result.
+      bool memory_mode;
+
+      // Fail tests leaving heap blocks allocated, with MICRO_TEST_LEAK_CHECK.
+      bool leak_mode;
+
+      // Last result of the current test and of the test before it, held
+      // back until leaks of their test are settled, or NO_ROW.
+      std::size_t leak_row;
+      std::size_t settle_row;
+      uint32_t settle_index;  // Test before the current one.
+
+      // Console results are reported at the end from the result table.
+      bool deferred_mode;
+
+      ResultTable results;
+      uint32_t test_index;
+
+      // Profile tests running longer than profile_ms milliseconds.
+      bool profile_mode;
+      double profile_ms;
+      bool profile_forked;  // The test ran code in a child, which is not sampled.
+
+      // Benchmark environment, CPUs timing tests are pinned to, raised
+      // priority, and whether timing assertions are refused on a noisy machine.
+      bool bench_env;
+      bool bench_nice;
+      bool bench_strict;
+      std::vector<int> bench_cpus;  // Given with --bench-env=cpus.
+      std::vector<int> bench_set;   // CPUs timing tests run on.
+      long long bench_throttles;
+
+      // Seed for generated test input, set by --seed, otherwise derived from
+      // the test description.
+      bool seed_set;
+      uint64_t seed_value;
+
+      // Live events written to a socket, FIFO or file, -1 when not streaming.
+      int stream_fd;
+      std::vector<char> stream_buffer;
+      std::size_t stream_used;
+      std::size_t stream_dropped;
+      std::string stream_line;
+
+      // Repeat mode, run the whole suite repeat_count times in child processes,
+      // repeat_jobs at a time. Children send results to the parent on repeat_fd.
+      uint32_t repeat_count;
+      uint32_t repeat_jobs;
+      double repeat_cv;
+      int repeat_fd;
+      uint32_t repeat_run;  // Run number of a worker, counting from 1.
+
+      // Machine readable report written as each result comes in, to
+      // format_path (stdout when empty). JUnit totals are filled in at
+      // format_header when the output can seek, -1 otherwise.
+      enum ReportFormat_e { RF_NONE, RF_JUNIT, RF_JSON, RF_TAP };
+      ReportFormat_e format;
+      std::string format_path;
+      std::string format_suite;
+      std::FILE * format_file;
+      long format_header;
+      double format_ms;
+      std::string format_line;
+
+      lambda_t setup;
+      lambda_t cleanup;
+
+      bool test_result;
+
+      // To capture cerr output
+      ErrorBuffer err_out;
+      std::streambuf * cerr_buf;
+
+      std::string test_description;
+
+      // When the body of the current test started, and how long it ran.
+      std::chrono::steady_clock::time_point test_start;
+      double test_elapsed_ms;
+      bool timing;  // Checks are timed, for --time and the modes reporting times.
+
+      // Extra detail reported under the test result, cleared after each test.
+      std::string test_note;
+
+      // Process memory, in bytes. Zero when not available on the platform.
+      struct MemoryUsage_t
+      {
+         long long rss;       // Resident set size now.
+         long long peak_rss;  // Highest resident set size so far.
+         long long heap;      // Heap bytes in use (glibc).
+      };
+
+      // Memory usage when the current test started.
+      MemoryUsage_t test_memory;
+
+#ifdef MICRO_TEST_MEMORY
+      static MemoryUsage_t memory_usage()
+      {
+         MemoryUsage_t usage = { 0, 0, 0 };
+
+#ifdef MICRO_TEST_POSIX
+         std::FILE * statm = std::fopen( "/proc/self/statm", "r" );
+
+         if ( statm )
+         {
+            unsigned long size = 0;
+            unsigned long resident = 0;
+
+            if ( std::fscanf( statm, "%lu %lu", &size, &resident ) == 2 )
+            {
+               usage.rss = static_cast<long long>( resident ) * sysconf( _SC_PAGESIZE );
+            }
+
+            std::fclose( statm );
+         }
+
+         struct rusage ru;
+
+         if ( getrusage( RUSAGE_SELF, &ru ) == 0 )
+         {
+#ifdef __APPLE__
+            usage.peak_rss = ru.ru_maxrss;
+#else
+            usage.peak_rss = static_cast<long long>( ru.ru_maxrss ) * 1024;
+#endif
+         }
+
+         // The kernel updates the high water mark lazily.
+         if ( usage.peak_rss < usage.rss )
+         {
+            usage.peak_rss = usage.rss;
+         }
+#endif
+
+#ifdef MICRO_TEST_MALLINFO2
+         const struct mallinfo2 info = mallinfo2();
+         usage.heap = static_cast<long long>( info.uordblks + info.hblkhd );
+#endif
+         return usage;
+      }
+
+      static std::string kilobytes( const long long i_bytes, const bool i_signed = false )
+      {
+         std::ostringstream out;
+
+         if ( i_signed && i_bytes >= 0 )
+         {
+            out << '+';
+         }
+
+         out << i_bytes / 1024 << " KB";
+         return out.str();
+      }
+
+      void memory_note()
+      {
+         const MemoryUsage_t now = memory_usage();
+         std::ostringstream note;
+
+         note << "Memory: RSS " << kilobytes( now.rss )
+              << " (" << kilobytes( now.rss - test_memory.rss, true ) << ")"
+              << ", peak RSS " << kilobytes( now.peak_rss )
+              << ", heap " << kilobytes( now.heap )
+              << " (" << kilobytes( now.heap - test_memory.heap, true ) << ")";
+
+         test_note += test_note.empty() ? note.str() : "\n      " + note.str();
+      }
+#endif
+
+      // Console report of one row of the result table.
+      void report_result( const std::size_t i_row ) const
+      {
+         const bool passed = results.passed( i_row );
+
+         if ( report_mode >= ( passed ? RM_FAIL : RM_SUMMARY ) )
+         {
+            return;
+         }
+
+         clog << ( passed ? PASS : FAIL )
+              << results.description( i_row )
+              << WHITE
+              << std::endl;
+
+         const std::string & note = results.note( i_row );
+
+         if ( !note.empty() )
+         {
+            clog << "      " << note << std::endl;
+         }
+      }
+
+#if defined( MICRO_TEST_BACKTRACE ) && defined( MICRO_TEST_REPORTS )
+      // Stack samples taken by the SIGPROF handler while a test body runs.
+      struct Profiler_t
+      {
+         enum { MAX_DEPTH = 64, MAX_SAMPLES = 8192, INTERVAL_US = 1000 };
+
+         std::vector<void *> frames;  // MAX_DEPTH frames per sample, leaf first.
+         std::vector<int> depth;      // Frames captured per sample.
+         std::atomic<std::size_t> count;
+      };
+
+      static Profiler_t & profiler()
+      {
+         static Profiler_t state;
+         return state;
+      }
+
+      // Only runs after profile_enable() has preloaded the unwinder.
+      static void on_profile_signal( int )
+      {
+         const int saved_errno = errno;
+         Profiler_t & state = profiler();
+         const std::size_t i = state.count.fetch_add( 1, std::memory_order_relaxed );
+
+         if ( i < Profiler_t::MAX_SAMPLES )
+         {
+            state.depth[i] = backtrace( &state.frames[i * Profiler_t::MAX_DEPTH],
+                                        Profiler_t::MAX_DEPTH );
+         }
+
+         errno = saved_errno;
+      }
+
+      void profile_enable()
+      {
+         Profiler_t & state = profiler();
+         state.frames.assign( Profiler_t::MAX_SAMPLES * Profiler_t::MAX_DEPTH, nullptr );
+         state.depth.assign( Profiler_t::MAX_SAMPLES, 0 );
+         state.count = 0;
+
+         // backtrace() is not async-signal-safe, its first call dlopens
+         // libgcc_s and allocates. Make that call here, at startup, so the
+         // calls from the SIGPROF handler only walk the stack.
+         void * warm_up[1];
+         backtrace( warm_up, 1 );
+
+         struct sigaction action;
+         std::memset( &action, 0, sizeof action );
+         action.sa_handler = &TestRunner::on_profile_signal;
+         action.sa_flags = SA_RESTART;
+         sigemptyset( &action.sa_mask );
+         sigaction( SIGPROF, &action, nullptr );
+      }
+
+      static void profile_timer( const bool i_on )
+      {
+         struct itimerval timer;
+         std::memset( &timer, 0, sizeof timer );
+
+         if ( i_on )
+         {
+            timer.it_interval.tv_usec = Profiler_t::INTERVAL_US;
+            timer.it_value.tv_usec = Profiler_t::INTERVAL_US;
+         }
+
+         setitimer( ITIMER_PROF, &timer, nullptr );
+      }
+
+      // Write the samples as folded stacks, one "root;...;leaf count" per line.
+      void profile_write( const double i_elapsed_ms )
+      {
+         Profiler_t & state = profiler();
+         const std::size_t taken = state.count.load();
+         const std::size_t max_samples = Profiler_t::MAX_SAMPLES;
+         const std::size_t samples = taken < max_samples ? taken : max_samples;
+
+         // Skip the signal handler and signal trampoline frames.
+         const int skip = 2;
+
+         std::map<void *, std::string> names;
+         std::map<std::string, std::size_t> stacks;
+
+         for ( std::size_t i = 0; i < samples; ++i )
+         {
+            void ** frames = &state.frames[i * Profiler_t::MAX_DEPTH];
+            std::string stack;
+
+            for ( int f = state.depth[i] - 1; f >= skip; --f )
+            {
+               std::map<void *, std::string>::iterator it = names.find( frames[f] );
+
+               if ( it == names.end() )
+               {
+                  it = names.insert( std::make_pair( frames[f], frame_name( frames[f] ) ) ).first;
+               }
+
+               if ( !stack.empty() )
+               {
+                  stack += ';';
+               }
+
+               stack += it->second;
+            }
+
+            if ( !stack.empty() )
+            {
+               ++stacks[stack];
+            }
+         }
+
+         std::ostringstream note;
+
+         // Timers are not inherited by fork, a test that ran in a child has
+         // nothing to write.
+         if ( stacks.empty() )
+         {
+            note << "Profile: no samples in " << i_elapsed_ms << " ms"
+                 << ( profile_forked ? ", the test ran in a child process" : "" );
+            test_note += test_note.empty() ? note.str() : "\n      " + note.str();
+            return;
+         }
+
+         std::string file_name;
+
+         for ( std::size_t i = 0; i < test_description.size() && file_name.size() < 100; ++i )
+         {
+            const char c = test_description[i];
+            file_name += std::isalnum( static_cast<unsigned char>( c ) ) ? c : '_';
+         }
+
+         // Tests may share a description, the row number keeps files apart,
+         // and the run number those of repeat workers running at once.
+         std::ostringstream suffix;
+
+         if ( repeat_run )
+         {
+            suffix << ".run" << repeat_run;
+         }
+
+         suffix << '.' << results.size() + 1 << ".folded";
+         file_name += suffix.str();
+
+         std::ofstream out( file_name.c_str() );
+
+         for ( std::map<std::string, std::size_t>::const_iterator it = stacks.begin();
+               it != stacks.end(); ++it )
+         {
+            out << it->first << ' ' << it->second << '\n';
+         }
+
+         note << "Profile: " << samples << " samples in " << i_elapsed_ms
+              << " ms written to " << file_name;
+
+         if ( taken > samples )
+         {
+            note << " (" << taken - samples << " samples dropped)";
+         }
+
+         test_note += test_note.empty() ? note.str() : "\n      " + note.str();
+      }
+#endif
+
+#ifdef MICRO_TEST_REPORTS
+      // Append i_text to o_out as the contents of a JSON string.
+      static void json_escape( std::string & o_out, const std::string & i_text )
+      {
+         static const char hex[] = "0123456789abcdef";
+
+         for ( std::size_t i = 0; i < i_text.size(); ++i )
+         {
+            const unsigned char c = static_cast<unsigned char>( i_text[i] );
+
+            switch ( c )
+            {
+            case '"':
+               o_out += "\\\"";
+               break;
+
+            case '\\':
+               o_out += "\\\\";
+               break;
+
+            case '\n':
+               o_out += "\\n";
+               break;
+
+            case '\t':
+               o_out += "\\t";
+               break;
+
+            default:
+               if ( c < 0x20 )
+               {
+                  o_out += "\\u00";
+                  o_out += hex[c >> 4];
+                  o_out += hex[c & 0xf];
+               }
+               else
+               {
+                  o_out += static_cast<char>( c );
+               }
+            } // switch
+         }
+      }
+
+      // Append i_text to o_out as XML text or attribute value. Control
+      // characters XML can't hold become '?'.
+      static void xml_escape( std::string & o_out, const std::string & i_text )
+      {
+         for ( std::size_t i = 0; i < i_text.size(); ++i )
+         {
+            const unsigned char c = static_cast<unsigned char>( i_text[i] );
+
+            switch ( c )
+            {
+            case '<':
+               o_out += "&lt;";
+               break;
+
+            case '>':
+               o_out += "&gt;";
+               break;
+
+            case '&':
+               o_out += "&amp;";
+               break;
+
+            case '"':
+               o_out += "&quot;";
+               break;
+
+            case '\n':
+            case '\t':
+               o_out += static_cast<char>( c );
+               break;
+
+            default:
+               o_out += c < 0x20 ? '?' : static_cast<char>( c );
+            } // switch
+         }
+      }
+
+      // Append i_value to format_line with a printf format.
+      void format_number( const char * const i_format, const double i_value )
+      {
+         char number[32];
+         std::snprintf( number, sizeof number, i_format, i_value );
+         format_line += number;
+      }
+
+      // Write format_line to the report and flush, so the report holds every
+      // result so far if the test program crashes.
+      void format_write()
+      {
+         std::fwrite( format_line.data(), 1, format_line.size(), format_file );
+         std::fflush( format_file );
+         format_line.clear();
+      }
+
+      void format_open()
+      {
+         format_file = format_path.empty() ? stdout : std::fopen( format_path.c_str(), "w" );
+
+         if ( !format_file )
+         {
+            clog << "Micro Test: cannot write report to " << format_path << ": "
+                 << std::strerror( errno ) << std::endl;
+            return;
+         }
+
+         if ( format == RF_JUNIT )
+         {
+            format_line = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuite name=\"";
+            xml_escape( format_line, format_suite );
+            format_line += "\"";
+
+            // Room for the totals, which are only known at the end.
+            if ( std::fseek( format_file, 0, SEEK_CUR ) == 0 )
+            {
+               format_header = std::ftell( format_file ) + static_cast<long>( format_line.size() );
+               format_line.append( 80, ' ' );
+            }
+
+            format_line += ">\n";
+         }
+         else if ( format == RF_TAP )
+         {
+            format_line = "TAP version 13\n";
+         }
+
+         format_write();
+      }
+
+      void format_result( const std::size_t i_row )
+      {
+         const bool passed = results.passed( i_row );
+         const std::string & description = results.description( i_row );
+         const std::string & note = results.note( i_row );
+         const float ms = results.ms( i_row );
+
+         format_ms += ms;
+
+         if ( format == RF_JUNIT )
+         {
+            format_line += "  <testcase name=\"";
+            xml_escape( format_line, description );
+            format_line += "\" time=\"";
+            format_number( "%.6f", ms / 1000.0 );
+
+            if ( passed && note.empty() )
+            {
+               format_line += "\"/>\n";
+            }
+            else
+            {
+               format_line += passed ? "\">\n    <system-out>" : "\">\n    <failure message=\"Test failed\">";
+               xml_escape( format_line, note );
+               format_line += passed ? "</system-out>\n  </testcase>\n" : "</failure>\n  </testcase>\n";
+            }
+         }
+         else if ( format == RF_JSON )
+         {
+            format_line += "{\"event\":\"result\",\"test\":";
+            format_number( "%.0f", results.test( i_row ) );
+            format_line += ",\"description\":\"";
+            json_escape( format_line, description );
+            format_line += passed ? "\",\"status\":\"pass\",\"ms\":" : "\",\"status\":\"fail\",\"ms\":";
+            format_number( "%.6g", ms );
+
+            if ( !note.empty() )
+            {
+               format_line += ",\"note\":\"";
+               json_escape( format_line, note );
+               format_line += '"';
+            }
+
+            format_line += "}\n";
+         }
+         else
+         {
+            format_line += passed ? "ok " : "not ok ";
+            format_number( "%.0f", i_row + 1 );
+            format_line += " - ";
+
+            // '#' would start a TAP directive.
+            for ( std::size_t i = 0; i < description.size(); ++i )
+            {
+               const char c = description[i];
+               format_line += c == '#' ? "\\#" : c == '\n' ? " " : std::string( 1, c );
+            }
+
+            format_line += "\n  ---\n  duration_ms: ";
+            format_number( "%.6g", ms );
+
+            if ( !note.empty() )
+            {
+               format_line += "\n  message: \"";
+               json_escape( format_line, note );
+               format_line += '"';
+            }
+
+            format_line += "\n  ...\n";
+         }
+
+         format_write();
+      }
+
+      void format_close()
+      {
+         if ( format == RF_JUNIT )
+         {
+            format_line = "</testsuite>\n";
+            format_write();
+
+            if ( format_header >= 0 && std::fseek( format_file, format_header, SEEK_SET ) == 0 )
+            {
+               format_line = " tests=\"";
+               format_number( "%.0f", pass + fail );
+               format_line += "\" failures=\"";
+               format_number( "%.0f", fail );
+               format_line += "\" time=\"";
+               format_number( "%.3f", format_ms / 1000.0 );
+               format_line += '"';
+               format_write();
+            }
+         }
+         else if ( format == RF_JSON )
+         {
+            format_line = "{\"event\":\"summary\",\"tests\":";
+            format_number( "%.0f", pass + fail );
+            format_line += ",\"passed\":";
+            format_number( "%.0f", pass );
+            format_line += ",\"failed\":";
+            format_number( "%.0f", fail );
+            format_line += "}\n";
+            format_write();
+         }
+         else
+         {
+            format_line = "1..";
+            format_number( "%.0f", pass + fail );
+            format_line += '\n';
+            format_write();
+         }
+
+         if ( format_file != stdout )
+         {
+            std::fclose( format_file );
+         }
+
+         format_file = nullptr;
+      }
+
+#ifdef MICRO_TEST_POSIX
+      void stream_open( const std::string & i_path )
+      {
+         struct stat info;
+         const bool exists = stat( i_path.c_str(), &info ) == 0;
+
+         if ( exists && S_ISSOCK( info.st_mode ) )
+         {
+            struct sockaddr_un address;
+            std::memset( &address, 0, sizeof address );
+            address.sun_family = AF_UNIX;
+            std::strncpy( address.sun_path, i_path.c_str(), sizeof address.sun_path - 1 );
+
+            stream_fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+            if ( stream_fd >= 0 &&
+                 connect( stream_fd, reinterpret_cast<struct sockaddr *>( &address ),
+                          sizeof address ) != 0 )
+            {
+               close( stream_fd );
+               stream_fd = -1;
+            }
+
+            if ( stream_fd >= 0 )
+            {
+               fcntl( stream_fd, F_SETFL, fcntl( stream_fd, F_GETFL ) | O_NONBLOCK );
+            }
+         }
+         else
+         {
+            // A FIFO without a reader fails here rather than blocking.
+            stream_fd = open( i_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK, 0644 );
+         }
+
+         if ( stream_fd < 0 )
+         {
+            clog << "Micro Test: cannot stream to " << i_path << ": "
+                 << std::strerror( errno ) << std::endl;
+            return;
+         }
+
+         stream_buffer.resize( 64 * 1024 );
+      }
+
+      // Write out as much buffered data as the reader will take without blocking.
+      void stream_flush()
+      {
+         if ( stream_fd < 0 || stream_used == 0 )
+         {
+            return;
+         }
+
+         // A reader going away must not kill the test program. Hold SIGPIPE
+         // while writing and take back one the write raises, leaving the
+         // host program's handler alone.
+         sigset_t pipe_set;
+         sigset_t old_set;
+         sigset_t pending;
+         sigemptyset( &pipe_set );
+         sigaddset( &pipe_set, SIGPIPE );
+         pthread_sigmask( SIG_BLOCK, &pipe_set, &old_set );
+         sigpending( &pending );
+         const bool was_pending = sigismember( &pending, SIGPIPE ) == 1;
+
+         std::size_t written = 0;
+
+         while ( stream_fd >= 0 && written < stream_used )
+         {
+            const ssize_t n = write( stream_fd, &stream_buffer[written], stream_used - written );
+
+            if ( n > 0 )
+            {
+               written += static_cast<std::size_t>( n );
+            }
+            else if ( n < 0 && errno == EINTR )
+            {
+               continue;
+            }
+            else
+            {
+               if ( n < 0 && errno == EPIPE && !was_pending )
+               {
+                  int signal_number;
+                  sigwait( &pipe_set, &signal_number );
+               }
+
+               if ( n < 0 && errno != EAGAIN && errno != EWOULDBLOCK )
+               {
+                  // Reader is gone, stop streaming.
+                  close( stream_fd );
+                  stream_fd = -1;
+               }
+
+               break;
+            }
+         }
+
+         pthread_sigmask( SIG_SETMASK, &old_set, nullptr );
+         std::memmove( &stream_buffer[0], &stream_buffer[written], stream_used - written );
+         stream_used -= written;
+      }
+
+      // Queue stream_line as one event, dropping it when the reader is behind.
+      void stream_event()
+      {
+         stream_line += '\n';
+
+         if ( stream_used + stream_line.size() > stream_buffer.size() )
+         {
+            stream_flush();
+         }
+
+         if ( stream_fd < 0 || stream_used + stream_line.size() > stream_buffer.size() )
+         {
+            ++stream_dropped;
+            return;
+         }
+
+         std::memcpy( &stream_buffer[stream_used], stream_line.data(), stream_line.size() );
+         stream_used += stream_line.size();
+         stream_flush();
+      }
+
+      void stream_close()
+      {
+         // Give a slow reader up to a second to take the rest.
+         for ( int tries = 0; stream_fd >= 0 && stream_used > 0 && tries < 10; ++tries )
+         {
+            struct pollfd ready = { stream_fd, POLLOUT, 0 };
+            poll( &ready, 1, 100 );
+            stream_flush();
+         }
+
+         if ( stream_fd >= 0 )
+         {
+            close( stream_fd );
+            stream_fd = -1;
+         }
+      }
+
+      void stream_start()
+      {
+         std::ostringstream line;
+         line << "{\"event\":\"start\",\"test\":" << test_index << ",\"description\":\"";
+         stream_line = line.str();
+         json_escape( stream_line, test_description );
+         stream_line += "\"}";
+         stream_event();
+      }
+
+      void stream_result( const std::size_t i_row )
+      {
+         std::ostringstream line;
+         line << "{\"event\":\"result\",\"test\":" << results.test( i_row )
+              << ",\"status\":\"" << ( results.passed( i_row ) ? "pass" : "fail" )
+              << "\",\"ms\":" << results.ms( i_row ) << "}";
+         stream_line = line.str();
+         stream_event();
+      }
+
+      void stream_summary()
+      {
+         std::ostringstream line;
+         line << "{\"event\":\"summary\",\"tests\":" << pass + fail
+              << ",\"passed\":" << pass
+              << ",\"failed\":" << fail
+              << ",\"dropped\":" << stream_dropped << "}";
+         stream_line = line.str();
+         stream_event();
+      }
+#endif
+
+#ifdef MICRO_TEST_POSIX
+      // Result record sent by a repeat worker, followed by the description.
+      enum { REPEAT_FAIL, REPEAT_PASS, REPEAT_START };
+
+      struct RepeatRecord_t
+      {
+         uint32_t index;
+         uint32_t status;  // REPEAT_PASS or REPEAT_FAIL, or REPEAT_START
+         double ms;        // when a test body starts running.
+         uint32_t size;
+      };
+
+      // Results of one test across all repeated runs.
+      struct RepeatStats_t
+      {
+         std::string description;
+         uint32_t runs;
+         uint32_t passes;
+         double mean_ms;
+         double m2;  // Sum of squared differences from the mean (Welford).
+      };
+
+      struct RepeatWorker_t
+      {
+         pid_t pid;
+         int fd;
+         uint32_t run;
+         std::string data;
+         std::string running;  // Last test started, named if the worker crashes.
+      };
+
+      void repeat_send( const uint32_t i_status, const std::size_t i_row )
+      {
+         const bool start = i_status == REPEAT_START;
+         const std::string & description = start ? test_description : results.description( i_row );
+         const RepeatRecord_t record = { static_cast<uint32_t>( i_row ), i_status,
+                                         start ? 0 : results.ms( i_row ),
+                                         static_cast<uint32_t>( description.size() )
+                                       };
+         std::string message( reinterpret_cast<const char *>( &record ), sizeof record );
+         message += description;
+
+         std::size_t written = 0;
+
+         while ( written < message.size() )
+         {
+            const ssize_t n = write( repeat_fd, message.data() + written, message.size() - written );
+
+            if ( n > 0 )
+            {
+               written += static_cast<std::size_t>( n );
+            }
+            else if ( n < 0 && errno != EINTR )
+            {
+               return;
+            }
+         }
+      }
+
+      // Parse the complete records a worker has sent so far.
+      static void repeat_collect( RepeatWorker_t & io_worker, std::vector<RepeatStats_t> & io_stats )
+      {
+         std::string & io_data = io_worker.data;
+         std::size_t used = 0;
+
+         while ( io_data.size() - used >= sizeof( RepeatRecord_t ) )
+         {
+            RepeatRecord_t record;
+            std::memcpy( &record, io_data.data() + used, sizeof record );
+
+            if ( io_data.size() - used - sizeof record < record.size )
+            {
+               break;
+            }
+
+            if ( record.status == REPEAT_START )
+            {
+               io_worker.running.assign( io_data, used + sizeof record, record.size );
+               used += sizeof record + record.size;
+               continue;
+            }
+
+            if ( record.index >= io_stats.size() )
+            {
+               const RepeatStats_t empty = { "", 0, 0, 0, 0 };
+               io_stats.resize( record.index + 1, empty );
+            }
+
+            RepeatStats_t & stats = io_stats[record.index];
+
+            if ( stats.runs == 0 )
+            {
+               stats.description.assign( io_data, used + sizeof record, record.size );
+            }
+
+            ++stats.runs;
+            stats.passes += record.status == REPEAT_PASS;
+
+            const double delta = record.ms - stats.mean_ms;
+            stats.mean_ms += delta / stats.runs;
+            stats.m2 += delta * ( record.ms - stats.mean_ms );
+
+            used += sizeof record + record.size;
+         }
+
+         io_data.erase( 0, used );
+      }
+
+      // Fork a worker that returns to run the test suite, sending its
+      // results down a pipe. Returns true in the worker.
+      bool repeat_spawn( std::vector<RepeatWorker_t> & io_workers, const uint32_t i_run )
+      {
+         int fd[2];
+
+         if ( pipe( fd ) != 0 )
+         {
+            return false;
+         }
+
+         clog.flush();
+         std::cout.flush();
+         std::fflush( nullptr );
+
+         const pid_t pid = fork();
+
+         if ( pid == 0 )
+         {
+            close( fd[0] );
+
+            for ( std::size_t i = 0; i < io_workers.size(); ++i )
+            {
+               close( io_workers[i].fd );
+            }
+
+            // Workers run quietly, the parent reports.
+            const int null_fd = open( "/dev/null", O_WRONLY );
+            dup2( null_fd, STDOUT_FILENO );
+            dup2( null_fd, STDERR_FILENO );
+            close( null_fd );
+
+            if ( stream_fd >= 0 )
+            {
+               close( stream_fd );
+               stream_fd = -1;
+            }
+
+            repeat_fd = fd[1];
+            repeat_run = i_run;
+            report_mode = RM_SUMMARY;
+            return true;
+         }
+
+         close( fd[1] );
+
+         if ( pid < 0 )
+         {
+            close( fd[0] );
+            return false;
+         }
+
+         const RepeatWorker_t worker = { pid, fd[0], i_run, "", "" };
+         io_workers.push_back( worker );
+         return false;
+      }
+
+      // Run the suite repeat_count times in workers and report flaky and
+      // noisy tests. Returns only inside a worker, the parent exits.
+      void repeat_suite()
+      {
+         std::vector<RepeatWorker_t> workers;
+         std::vector<RepeatStats_t> stats;
+         uint32_t started = 0;
+         uint32_t crashed = 0;
+         uint32_t exited = 0;
+
+         banner();
+
+#if defined( __linux__ ) && defined( MICRO_TEST_TIMING )
+         // Report on the machine once, each worker sets up its own runs.
+         if ( bench_env )
+         {
+            bench_setup();
+         }
+#endif
+
+         clog << "Repeating tests " << repeat_count << " times, "
+              << repeat_jobs << " at a time." << std::endl;
+
+         while ( started < repeat_count || !workers.empty() )
+         {
+            while ( started < repeat_count && workers.size() < repeat_jobs )
+            {
+               ++started;
+
+               if ( repeat_spawn( workers, started ) )
+               {
+                  return;
+               }
+            }
+
+            std::vector<struct pollfd> ready( workers.size() );
+
+            for ( std::size_t i = 0; i < workers.size(); ++i )
+            {
+               ready[i].fd = workers[i].fd;
+               ready[i].events = POLLIN;
+               ready[i].revents = 0;
+            }
+
+            if ( !ready.empty() && poll( &ready[0], ready.size(), -1 ) < 0 && errno != EINTR )
+            {
+               break;
+            }
+
+            for ( std::size_t i = workers.size(); i-- > 0; )
+            {
+               if ( !ready[i].revents )
+               {
+                  continue;
+               }
+
+               char buffer[4096];
+               const ssize_t n = read( workers[i].fd, buffer, sizeof buffer );
+
+               if ( n > 0 )
+               {
+                  workers[i].data.append( buffer, static_cast<std::size_t>( n ) );
+                  repeat_collect( workers[i], stats );
+                  continue;
+               }
+
+               if ( n < 0 && errno == EINTR )
+               {
+                  continue;
+               }
+
+               close( workers[i].fd );
+
+               int status = 0;
+
+               while ( waitpid( workers[i].pid, &status, 0 ) < 0 && errno == EINTR )
+               {
+               }
+
+               if ( WIFSIGNALED( status ) )
+               {
+                  ++crashed;
+                  clog << FAIL << "Crashed (signal " << WTERMSIG( status ) << ") run "
+                       << workers[i].run << " in " << workers[i].running << WHITE << std::endl;
+               }
+               else if ( WIFEXITED( status ) && WEXITSTATUS( status ) != 0 )
+               {
+                  ++exited;
+                  clog << FAIL << "Exited (status " << WEXITSTATUS( status ) << ") run "
+                       << workers[i].run << " in " << workers[i].running << WHITE << std::endl;
+               }
+
+               workers.erase( workers.begin() + i );
+            }
+         }
+
+         uint32_t flaky = 0;
+         uint32_t failing = 0;
+         uint32_t noisy = 0;
+
+         for ( std::size_t i = 0; i < stats.size(); ++i )
+         {
+            const RepeatStats_t & test = stats[i];
+
+            if ( test.runs == 0 )
+            {
+               continue;
+            }
+
+            const double cv = test.runs > 1 && test.mean_ms > 0
+                              ? std::sqrt( test.m2 / ( test.runs - 1 ) ) / test.mean_ms
+                              : 0;
+
+            bool shown = true;
+
+            if ( test.passes > 0 && test.passes < test.runs )
+            {
+               ++flaky;
+               clog << FAIL << "Flaky (" << test.passes << "/" << test.runs << " passed) "
+                    << test.description << WHITE << std::endl;
+            }
+            else if ( test.passes == 0 )
+            {
+               ++failing;
+               shown = report_mode < RM_SUMMARY;
+
+               if ( shown )
+               {
+                  clog << FAIL << test.description << WHITE << std::endl;
+               }
+            }
+            else
+            {
+               shown = report_mode < RM_FAIL;
+
+               if ( shown )
+               {
+                  clog << PASS << test.description << WHITE << std::endl;
+               }
+            }
+
+            // Sub 0.1 ms timings are mostly clock noise.
+            if ( cv > repeat_cv && test.mean_ms >= 0.1 )
+            {
+               ++noisy;
+
+               if ( !shown )
+               {
+                  clog << "Noisy: " << test.description << std::endl;
+               }
+
+               clog << "      Timing: mean " << test.mean_ms << " ms, CV " << cv
+                    << " over " << test.runs << " runs" << std::endl;
+            }
+         }
+
+         clog << "==============================================\n";
+         clog << "Repeat Summary: Runs(" << repeat_count << ") "
+              << "Checks(" << stats.size() << ") "
+              << "Flaky(" << flaky << ") "
+              << "Failed(" << failing << ") "
+              << "Noisy(" << noisy << ") "
+              << "Crashed(" << crashed << ") "
+              << "Exited(" << exited << ")\n" << std::endl;
+
+         std::exit( flaky || failing || crashed || exited ? 1 : 0 );
+      }
+#endif
+#endif
+
+#ifdef MICRO_TEST_TIMING
+#ifdef __linux__
+      // First line of a /proc or /sys file, empty if it can't be read.
+      static std::string read_line( const std::string & i_path )
+      {
+         std::ifstream in( i_path.c_str() );
+         std::string line;
+         std::getline( in, line );
+         return line;
+      }
+
+      // CPU numbers in a list like "0-3,6", false if it isn't one.
+      static bool parse_cpus( const std::string & i_list, std::vector<int> & o_cpus )
+      {
+         std::istringstream in( i_list );
+         std::string range;
+
+         o_cpus.clear();
+
+         while ( std::getline( in, range, ',' ) )
+         {
+            const std::size_t dash = range.find( '-' );
+            const std::string first_text = range.substr( 0, dash );
+            const std::string last_text = dash == std::string::npos ? first_text : range.substr( dash + 1 );
+
+            if ( first_text.empty() || last_text.empty() ||
+                 first_text.find_first_not_of( "0123456789" ) != std::string::npos ||
+                 last_text.find_first_not_of( "0123456789" ) != std::string::npos )
+            {
+               return false;
+            }
+
+            const int first = std::atoi( first_text.c_str() );
+            const int last = std::atoi( last_text.c_str() );
+
+            if ( first > last || last >= CPU_SETSIZE )
+            {
+               return false;
+            }
+
+            for ( int cpu = first; cpu <= last; ++cpu )
+            {
+               o_cpus.push_back( cpu );
+            }
+         }
+
+         return !o_cpus.empty();
+      }
+
+      static std::vector<int> affinity_cpus()
+      {
+         std::vector<int> cpus;
+         cpu_set_t set;
+         CPU_ZERO( &set );
+
+         if ( sched_getaffinity( 0, sizeof set, &set ) == 0 )
+         {
+            for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+            {
+               if ( CPU_ISSET( cpu, &set ) )
+               {
+                  cpus.push_back( cpu );
+               }
+            }
+         }
+
+         return cpus;
+      }
+
+      // Thermal throttle events on i_cpus since boot.
+      static long long throttle_count( const std::vector<int> & i_cpus )
+      {
+         long long count = 0;
+
+         for ( std::size_t i = 0; i < i_cpus.size(); ++i )
+         {
+            std::ostringstream path;
+            path << "/sys/devices/system/cpu/cpu" << i_cpus[i] << "/thermal_throttle/";
+            count += std::atoll( read_line( path.str() + "core_throttle_count" ).c_str() );
+            count += std::atoll( read_line( path.str() + "package_throttle_count" ).c_str() );
+         }
+
+         return count;
+      }
+
+      // Why timing results can't be trusted right now, empty if they can.
+      // A frequency governor other than performance is only reported with
+      // i_governor, on most machines it is not something the user can change.
+      std::string bench_noise( const bool i_governor ) const
+      {
+         std::ostringstream noise;
+         const std::vector<int> & cpus = bench_set;
+
+         for ( std::size_t i = 0; i < cpus.size(); ++i )
+         {
+            std::ostringstream base;
+            base << "/sys/devices/system/cpu/cpu" << cpus[i];
+
+            const std::string governor = read_line( base.str() + "/cpufreq/scaling_governor" );
+
+            if ( i_governor && !governor.empty() && governor != "performance" )
+            {
+               noise << "\n      cpu" << cpus[i] << " frequency governor is " << governor
+                     << ", not performance";
+            }
+
+            std::vector<int> siblings;
+            parse_cpus( read_line( base.str() + "/topology/thread_siblings_list" ), siblings );
+
+            // A sibling in the set runs the same timing test, only one
+            // outside it is running something else.
+            for ( std::size_t s = 0; s < siblings.size(); ++s )
+            {
+               if ( std::find( cpus.begin(), cpus.end(), siblings[s] ) == cpus.end() )
+               {
+                  noise << "\n      cpu" << cpus[i] << " shares its core with SMT sibling cpu"
+                        << siblings[s];
+               }
+            }
+         }
+
+         const long online = sysconf( _SC_NPROCESSORS_ONLN );
+         const double load = std::atof( read_line( "/proc/loadavg" ).c_str() );
+
+         // This process accounts for one.
+         if ( load - 1 > online / 2.0 )
+         {
+            noise << "\n      load average " << load << " on " << online << " CPUs";
+         }
+
+         const long long throttles = throttle_count( cpus ) - bench_throttles;
+
+         if ( throttles > 0 )
+         {
+            noise << "\n      CPU thermal throttled " << throttles << " times during the run";
+         }
+
+         return noise.str();
+      }
+
+      // Pins the calling thread to i_cpus while a timing test runs, and
+      // puts back its own CPU set after. Threads it starts inherit the set.
+      class BenchPin_t
+      {
+         cpu_set_t saved;
+         bool pinned;
+
+         BenchPin_t( const BenchPin_t & ) = delete;
+         BenchPin_t & operator=( const BenchPin_t & ) = delete;
+
+      public:
+         explicit BenchPin_t( const std::vector<int> & i_cpus ) : pinned{}
+         {
+            if ( i_cpus.empty() || sched_getaffinity( 0, sizeof saved, &saved ) != 0 )
+            {
+               return;
+            }
+
+            cpu_set_t set;
+            CPU_ZERO( &set );
+
+            for ( std::size_t i = 0; i < i_cpus.size(); ++i )
+            {
+               CPU_SET( i_cpus[i], &set );
+            }
+
+            pinned = sched_setaffinity( 0, sizeof set, &set ) == 0;
+         }
+         ~BenchPin_t()
+         {
+            if ( pinned )
+            {
+               sched_setaffinity( 0, sizeof saved, &saved );
+            }
+         }
+      };
+
+      // Choose the CPUs for timing tests, raise priority and report on how
+      // quiet the machine is. The process itself is not pinned.
+      void bench_setup()
+      {
+         bench_set = bench_cpus;
+
+         // CPU 0 usually takes the most interrupts, default to the last CPU.
+         if ( bench_set.empty() )
+         {
+            const std::vector<int> allowed = affinity_cpus();
+
+            if ( !allowed.empty() )
+            {
+               bench_set.push_back( allowed.back() );
+            }
+         }
+
+         clog << "Bench env: timing tests pinned to cpu";
+
+         for ( std::size_t i = 0; i < bench_set.size(); ++i )
+         {
+            clog << ( i ? "," : "" ) << bench_set[i];
+         }
+
+         if ( bench_nice )
+         {
+            if ( setpriority( PRIO_PROCESS, 0, -10 ) == 0 )
+            {
+               clog << ", priority raised";
+            }
+            else
+            {
+               clog << ", can't raise priority (" << std::strerror( errno ) << ")";
+            }
+         }
+
+         clog << std::endl;
+
+         bench_throttles = throttle_count( bench_set );
+
+         const std::string noise = bench_noise( true );
+
+         if ( !noise.empty() )
+         {
+            clog << "Warning: timing results may be unreliable" << noise << std::endl;
+         }
+      }
+#endif
+
+      // In strict bench mode, fail a timing test without running it when
+      // the machine is too noisy. Returns true when the test was refused.
+      bool bench_refused()
+      {
+#ifdef __linux__
+         if ( bench_strict )
+         {
+            const std::string noise = bench_noise( false );
+
+            if ( !noise.empty() )
+            {
+               test_note = "Timing test not run, machine too noisy:" + noise;
+               test_status_fail();
+               return true;
+            }
+         }
+#endif
+         return false;
+      }
+#endif
+
+      // Settle the leaks of the test before the current one. When blocks it
+      // allocated are still live its held result fails with a note on them,
+      // grouped by allocation stack, or a failed result is added when it
+      // made no checks. The held result is then reported.
+      void leak_settle()
+      {
+         if ( !Leaks::state().settling && settle_row == NO_ROW )
+         {
+            return;
+         }
+
+         const Leaks::Pause pause;
+         bool live = false;
+         const uint32_t test = Leaks::settle( live );
+         const std::string note = live ? Leaks::state().report( test ) : std::string();
+
+         if ( !note.empty() )
+         {
+            if ( settle_row == NO_ROW )
+            {
+               settle_row = results.add( settle_index, false, 0 );
+               ++fail;
+            }
+            else if ( results.passed( settle_row ) )
+            {
+               results.set_passed( settle_row, false );
+               --pass;
+               ++fail;
+            }
+
+            const std::string & other = results.note( settle_row );
+            results.set_note( settle_row, other.empty() ? note : other + "\n      " + note );
+         }
+
+         if ( settle_row != NO_ROW )
+         {
+            release_result( settle_row );
+            settle_row = NO_ROW;
+         }
+
+         Leaks::sweep();
+      }
+
+      // Settle the test before the last one, the last one is settled next,
+      // and track the test starting now when i_track.
+      void leak_next( const bool i_track )
+      {
+         leak_settle();
+         settle_row = leak_row;
+         settle_index = test_index;
+         leak_row = NO_ROW;
+         Leaks::begin( i_track );
+      }
+
+      // Set the description of the next test and start it.
+      void start_test( const char * const i_message, const std::size_t i_size )
+      {
+         // The test just finished is settled after this, once a description
+         // made for this test is freed. Blocks allocated by setup belong to
+         // this test.
+         if ( Leaks::installed() )
+         {
+            leak_next( leak_mode );
+         }
+
+#ifdef MICRO_TEST_MEMORY
+         if ( memory_mode )
+         {
+            test_memory = memory_usage();
+         }
+#endif
+
+         if ( setup )
+         {
+            setup();
+         }
+
+         const Leaks::Pause pause;
+         test_description.assign( i_message, i_size );
+         test_index = results.add_test( test_description );
+         begin_test();
+      }
+
+#ifdef MICRO_TEST_REPORTS
+      void publish_result( const std::size_t i_row )
+      {
+         if ( format_file )
+         {
+            format_result( i_row );
+         }
+
+#ifdef MICRO_TEST_POSIX
+         if ( stream_fd >= 0 )
+         {
+            stream_result( i_row );
+         }
+
+         if ( repeat_fd >= 0 )
+         {
+            repeat_send( results.passed( i_row ) ? REPEAT_PASS : REPEAT_FAIL, i_row );
+         }
+#endif
+      }
+#endif
+
+      // Called when the body of a test starts running.
+      void begin_test()
+      {
+#if defined( MICRO_TEST_POSIX ) && defined( MICRO_TEST_REPORTS )
+         if ( stream_fd >= 0 )
+         {
+            stream_start();
+         }
+
+         if ( repeat_fd >= 0 )
+         {
+            repeat_send( REPEAT_START, results.size() );
+         }
+#endif
+
+         begin_check();
+      }
+
+      // Called when a check starts, with the test body or after the check
+      // before it was reported. Each check is timed and profiled on its own,
+      // so the times of a block's checks add up to the block's time.
+      void begin_check()
+      {
+         if ( timing )
+         {
+            test_start = std::chrono::steady_clock::now();
+         }
+
+#if defined( MICRO_TEST_BACKTRACE ) && defined( MICRO_TEST_REPORTS )
+         if ( profile_mode )
+         {
+            profiler().count = 0;
+            profile_forked = false;
+            profile_timer( true );
+         }
+#endif
+      }
+
+      // Called when the result of a test is known, before it is reported.
+      void end_test()
+      {
+         if ( timing )
+         {
+            test_elapsed_ms = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - test_start ).count();
+         }
+
+#if defined( MICRO_TEST_BACKTRACE ) && defined( MICRO_TEST_REPORTS )
+         if ( profile_mode )
+         {
+            profile_timer( false );
+
+            if ( test_elapsed_ms >= profile_ms )
+            {
+               profile_write( test_elapsed_ms );
+            }
+         }
+#endif
+      }
+
+      void record_result()
+      {
+         if ( Leaks::installed() )
+         {
+            leak_settle();
+         }
+
+         std::size_t row = results.add( test_index, test_result, static_cast<float>( test_elapsed_ms ) );
+
+#ifdef MICRO_TEST_MEMORY
+         if ( memory_mode )
+         {
+            memory_note();
+         }
+#endif
+
+         if ( !test_note.empty() )
+         {
+            results.set_note( row, test_note );
+            std::string().swap( test_note );
+         }
+
+         // Leaks of the test may still fail its last result.
+         if ( Leaks::state().test.load( std::memory_order_relaxed ) )
+         {
+            std::swap( row, leak_row );
+         }
+
+         if ( row != NO_ROW )
+         {
+            release_result( row );
+         }
+      }
+
+      // Pass a result on to the outputs.
+      void release_result( const std::size_t i_row )
+      {
+#ifdef MICRO_TEST_REPORTS
+         publish_result( i_row );
+#endif
+
+         if ( !deferred_mode && report_mode < ( results.passed( i_row ) ? RM_FAIL : RM_SUMMARY ) )
+         {
+            report_result( i_row );
+         }
+      }
+
+      void test_status_pass()
+      {
+         const Leaks::Pause pause;
+         end_test();
+         ++pass;
+         test_result = true;
+         record_result();
+         begin_check();
+      }
+
+      void test_status_fail()
+      {
+         const Leaks::Pause pause;
+         end_test();
+         ++fail;
+         test_result = false;
+         record_result();
+         begin_check();
+      }
+
+      void check( const bool i_status )
+      {
+         Fixture fix( this );
+
+         if ( i_status )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+
+         // Clear error buffer
+         err_out.str( "" );
+      }
+
+      void banner() const
+      {
+         clog << "\no=================================================o\n"
+              << "| Micro Test v" << VERSION << " for C/C++                     |\n"
+              << "|                                                 |\n"
+              << "| https://bitbucket.org/rajinder_yadav/micro_test |\n"
+              << "o=================================================o"
+              << std::endl;
+      }
+
+      void usage( const char * const i_program ) const
+      {
+         std::cout << "\nMicro Test Usage\n"
+                   << "================\n\n"
+                   << i_program << " [OPTIONS]\n\n"
+                   << "OPTIONS\n"
+                   << "   <blank>  No arguments passed, show all test results.\n"
+                   << "   -a       Show all test results.\n"
+                   << "   -f       Show only failing results.\n"
+                   << "   -s       Show only the summary report.\n"
+#ifdef MICRO_TEST_MEMORY
+                   << "   -m       Show memory usage with each test result.\n"
+#endif
+#if defined( MICRO_TEST_BACKTRACE ) && defined( MICRO_TEST_REPORTS )
+                   << "   --profile[=ms]\n"
+                   << "            Sample the stack of tests running longer than ms\n"
+                   << "            milliseconds (default 100), write folded stacks\n"
+                   << "            to <test description>.<result>.folded.\n"
+#endif
+#if defined( __linux__ ) && defined( MICRO_TEST_TIMING )
+                   << "   --bench-env[=cpus]\n"
+                   << "            Pin timing tests to a CPU list like 2,3 or 4-7 (default\n"
+                   << "            the last CPU) and warn when timing may be unreliable.\n"
+                   << "   --bench-nice\n"
+                   << "            Also raise the scheduling priority.\n"
+                   << "   --bench-strict\n"
+                   << "            Fail timing tests without running them when the\n"
+                   << "            machine is too noisy.\n"
+#endif
+#ifdef MICRO_TEST_REPORTS
+                   << "   --format=junit|json|tap\n"
+                   << "            Also write results as JUnit XML, JSON lines or TAP\n"
+                   << "            as each test completes.\n"
+                   << "   --output=file\n"
+                   << "            File for --format (default stdout).\n"
+#endif
+                   << "   --deferred\n"
+                   << "            Report test results at the end of the run.\n"
+                   << "   --time   Time each check for the result table, on with\n"
+                   << "            --format, --stream, --repeat and --profile.\n"
+                   << "   --seed=n Seed for generated test input, by default each\n"
+                   << "            test is seeded from its description.\n"
+#if defined( MICRO_TEST_POSIX ) && defined( MICRO_TEST_REPORTS )
+                   << "   --stream=path\n"
+                   << "            Stream test events as JSON lines to a Unix socket,\n"
+                   << "            FIFO or file. Events are dropped, not waited on,\n"
+                   << "            when the reader falls behind.\n"
+                   << "   --repeat=n\n"
+                   << "            Run the tests n times, each run in its own process,\n"
+                   << "            and report flaky tests and noisy timings.\n"
+                   << "   --jobs=n Repeat runs to execute at the same time (default 1).\n"
+                   << "   --cv=x   Report tests whose timing coefficient of variation\n"
+                   << "            is above x in repeat mode (default 0.25).\n"
+#endif
+                   << "   -h       Output this usage message and exit.\n\n";
+         std::exit( 1 );
+      }
+
+      void long_option( const char * const i_program, const std::string & i_option )
+      {
+         const std::size_t equal = i_option.find( '=' );
+         const std::string name = i_option.substr( 0, equal );
+         const std::string value = equal == std::string::npos ? "" : i_option.substr( equal + 1 );
+
+#if defined( MICRO_TEST_BACKTRACE ) && defined( MICRO_TEST_REPORTS )
+         if ( name == "profile" )
+         {
+            profile_mode = true;
+            profile_ms = value.empty() ? 100.0 : std::atof( value.c_str() );
+            profile_enable();
+            return;
+         }
+#endif
+
+#if defined( __linux__ ) && defined( MICRO_TEST_TIMING )
+         if ( name == "bench-env" )
+         {
+            bench_env = true;
+
+            if ( value.empty() || parse_cpus( value, bench_cpus ) )
+            {
+               return;
+            }
+
+            clog << "Micro Test: --bench-env needs a CPU list like 2,3 or 4-7, not \""
+                 << value << "\"" << std::endl;
+         }
+
+         if ( name == "bench-nice" )
+         {
+            bench_env = true;
+            bench_nice = true;
+            return;
+         }
+
+         if ( name == "bench-strict" )
+         {
+            bench_env = true;
+            bench_strict = true;
+            return;
+         }
+#endif
+
+#ifdef MICRO_TEST_REPORTS
+         if ( name == "format" )
+         {
+            format = value == "junit" ? RF_JUNIT : value == "json" ? RF_JSON :
+                     value == "tap" ? RF_TAP : RF_NONE;
+
+            if ( format != RF_NONE )
+            {
+               const char * const slash = std::strrchr( i_program, '/' );
+               format_suite = slash ? slash + 1 : i_program;
+               return;
+            }
+         }
+
+         if ( name == "output" && !value.empty() )
+         {
+            format_path = value;
+            return;
+         }
+#endif
+
+         if ( name == "deferred" )
+         {
+            deferred_mode = true;
+            return;
+         }
+
+         if ( name == "time" )
+         {
+            timing = true;
+            return;
+         }
+
+         if ( name == "seed" && !value.empty() )
+         {
+            seed_set = true;
+            seed_value = std::strtoull( value.c_str(), nullptr, 0 );
+            return;
+         }
+
+#if defined( MICRO_TEST_POSIX ) && defined( MICRO_TEST_REPORTS )
+         if ( name == "stream" && !value.empty() )
+         {
+            stream_open( value );
+            return;
+         }
+
+         if ( name == "repeat" && std::atoi( value.c_str() ) > 0 )
+         {
+            repeat_count = static_cast<uint32_t>( std::atoi( value.c_str() ) );
+            return;
+         }
+
+         if ( name == "jobs" && std::atoi( value.c_str() ) > 0 )
+         {
+            repeat_jobs = static_cast<uint32_t>( std::atoi( value.c_str() ) );
+            return;
+         }
+
+         if ( name == "cv" && std::atof( value.c_str() ) > 0 )
+         {
+            repeat_cv = std::atof( value.c_str() );
+            return;
+         }
+#endif
+
+         usage( i_program );
+      }
+
+      void program_arguments( const int i_argc, const char * const i_argv[] )
+      {
+         report_mode = RM_ALL;
+
+         for ( int i = 1; i < i_argc; ++i )
+         {
+            const char * const arg = i_argv[i];
+
+            if ( arg[0] != '-' )
+            {
+               usage( i_argv[0] );
+            }
+
+            switch ( arg[1] )
+            {
+            case 'a':
+               report_mode = RM_ALL;
+               break;
+
+            case 'f':
+               report_mode = RM_FAIL;
+               break;
+
+            case 's':
+               report_mode = RM_SUMMARY;
+               break;
+
+#ifdef MICRO_TEST_MEMORY
+            case 'm':
+               memory_mode = true;
+               break;
+#endif
+
+            case '-':
+               long_option( i_argv[0], arg + 2 );
+               break;
+
+            default:
+               usage( i_argv[0] );
+            } // switch
+         }
+      }
+
+      template <typename TEX, typename F>
+      void exception( F & i_fn,
+                      const bool i_exception_expected = true )
+      {
+         bool exception_thrown = false;
+         Fixture fix( this );
+
+         try
+         {
+            i_fn();
+            exception_thrown = false;
+         }
+         catch ( TEX & ex )
+         {
+            exception_thrown = true;
+         }
+         catch ( ... )
+         {
+            // Not the exception tested for.
+            exception_thrown = false;
+         }
+
+         if ( ( exception_thrown && i_exception_expected ) ||
+              ( !exception_thrown && !i_exception_expected ) )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+
+         // Clear error buffer
+         err_out.str( "" );
+      }
+
+      uint64_t test_seed() const
+      {
+         if ( seed_set )
+         {
+            return seed_value;
+         }
+
+         // FNV-1a, stable across runs and platforms.
+         uint64_t hash = 0xcbf29ce484222325ULL;
+
+         for ( std::size_t i = 0; i < test_description.size(); ++i )
+         {
+            hash = ( hash ^ static_cast<unsigned char>( test_description[i] ) ) * 0x100000001b3ULL;
+         }
+
+         return hash;
+      }
+
+#if defined( MICRO_TEST_PROPERTY ) || defined( MICRO_TEST_TIMING ) || defined( MICRO_TEST_ROWS )
+      // Threads for parallel_for, one less than the cores, started on first
+      // use and kept waiting for work until the process exits.
+      class WorkerPool_t
+      {
+         std::mutex lock;
+         std::condition_variable wake;
+         std::condition_variable idle;
+         std::vector<std::thread> threads;
+         uint64_t round;     // Jobs started, a worker runs each one once.
+         std::size_t busy;   // Workers still in the current job.
+
+         void ( *call )( void *, std::size_t, std::size_t );
+         void * job;
+         std::size_t count;
+         std::size_t slice;
+         std::atomic<std::size_t> next;
+
+#ifdef MICRO_TEST_POSIX
+         const pid_t owner;  // Threads are not copied into a forked child.
+#endif
+
+         WorkerPool_t()
+            : round{}, busy{}, call{}, job{}, count{}, slice{}, next{}
+#ifdef MICRO_TEST_POSIX
+            , owner( getpid() )
+#endif
+         {
+            const unsigned cores = std::thread::hardware_concurrency();
+
+            for ( unsigned i = 1; i < cores; ++i )
+            {
+               threads.push_back( std::thread( [this]
+               {
+                  work();
+               } ) );
+            }
+         }
+
+         template <typename F>
+         static void invoke( void * i_job, const std::size_t i_begin, const std::size_t i_end )
+         {
+            ( *static_cast<F *>( i_job ) )( i_begin, i_end );
+         }
+
+         // Take slices of the current job until none are left.
+         void run()
+         {
+            for ( std::size_t i = next++; i * slice < count; i = next++ )
+            {
+               const std::size_t begin = i * slice;
+               call( job, begin, begin + slice < count ? begin + slice : count );
+            }
+         }
+
+         void work()
+         {
+            std::unique_lock<std::mutex> guard( lock );
+            uint64_t seen = 0;
+
+            for ( ;; )
+            {
+               wake.wait( guard, [&]
+               {
+                  return round != seen;
+               } );
+               seen = round;
+
+               guard.unlock();
+               run();
+               guard.lock();
+
+               if ( --busy == 0 )
+               {
+                  idle.notify_one();
+               }
+            }
+         }
+
+      public:
+         std::mutex use;  // Held by the thread running a job.
+
+         // Never destroyed, its threads may still be waiting at exit.
+         static WorkerPool_t & instance()
+         {
+            static WorkerPool_t * const pool = []
+            {
+               const Leaks::Pause pause;
+               return new WorkerPool_t;
+            }();
+            return *pool;
+         }
+
+         bool usable() const
+         {
+#ifdef MICRO_TEST_POSIX
+            return !threads.empty() && owner == getpid();
+#else
+            return !threads.empty();
+#endif
+         }
+
+         // Run i_fn over [0, i_count) on the workers and the calling thread.
+         template <typename F>
+         void execute( const std::size_t i_count, F & i_fn )
+         {
+            {
+               std::lock_guard<std::mutex> guard( lock );
+               call = &WorkerPool_t::invoke<F>;
+               job = &i_fn;
+               count = i_count;
+               slice = ( i_count + threads.size() ) / ( threads.size() + 1 );
+               next = 0;
+               busy = threads.size();
+               ++round;
+            }
+
+            wake.notify_all();
+
+            // The workers still use i_fn, wait for them before leaving.
+            std::exception_ptr error;
+
+            try
+            {
+               run();
+            }
+            catch ( ... )
+            {
+               error = std::current_exception();
+            }
+
+            std::unique_lock<std::mutex> guard( lock );
+            idle.wait( guard, [&]
+            {
+               return busy == 0;
+            } );
+
+            if ( error )
+            {
+               std::rethrow_exception( error );
+            }
+         }
+      };
+
+      // Run i_fn( begin, end ) over [0, i_count), one slice per core. A call
+      // made while the workers are busy, or in a forked child, runs inline.
+      template <typename F>
+      static void parallel_for( const std::size_t i_count, F i_fn )
+      {
+         if ( i_count == 0 )
+         {
+            return;
+         }
+
+         WorkerPool_t & pool = WorkerPool_t::instance();
+         std::unique_lock<std::mutex> use( pool.use, std::try_to_lock );
+
+         if ( !use.owns_lock() || !pool.usable() )
+         {
+            i_fn( 0, i_count );
+            return;
+         }
+
+         pool.execute( i_count, i_fn );
+      }
+
+      static void atomic_min( std::atomic<std::size_t> & io_value, const std::size_t i_value )
+      {
+         std::size_t current = io_value.load();
+
+         while ( i_value < current && !io_value.compare_exchange_weak( current, i_value ) )
+         {
+         }
+      }
+#endif
+
+#if defined( MICRO_TEST_PROPERTY ) || defined( MICRO_TEST_TIMING )
+      // Text for a value in test notes, when it can be written to a stream.
+      template <typename T>
+      static auto describe( const T & i_value, int )
+      -> decltype( std::declval<std::ostream &>() << i_value, std::string() )
+      {
+         std::ostringstream out;
+
+         // Enough digits to tell apart any two values of the type.
+         if ( std::is_floating_point<T>::value )
+         {
+            out.precision( std::numeric_limits<T>::max_digits10 );
+         }
+
+         out << i_value;
+         return out.str();
+      }
+      template <typename T>
+      static std::string describe( const T &, long )
+      {
+         return "(not printable)";
+      }
+      static std::string describe( const std::string & i_value, int )
+      {
+         return "\"" + i_value + "\"";
+      }
+      template <typename T>
+      static std::string describe( const std::vector<T> & i_values, int )
+      {
+         std::string text( "[" );
+
+         for ( std::size_t i = 0; i < i_values.size(); ++i )
+         {
+            text += ( i ? ", " : "" ) + describe( i_values[i], 0 );
+         }
+
+         return text + "]";
+      }
+
+      // Message of a caught exception.
+      static std::string describe_error( const std::exception_ptr & i_error )
+      {
+         try
+         {
+            std::rethrow_exception( i_error );
+         }
+         catch ( const std::exception & ex )
+         {
+            return ex.what();
+         }
+         catch ( ... )
+         {
+            return "unknown exception";
+         }
+      }
+#endif
+
+#ifdef MICRO_TEST_PROPERTY
+      // Compile time index list for unpacking tuples.
+      template <std::size_t... I>
+      struct Indices_t
+      {
+      };
+      template <std::size_t N, std::size_t... I>
+      struct MakeIndices_t : MakeIndices_t < N - 1, N - 1, I... >
+      {
+      };
+      template <std::size_t... I>
+      struct MakeIndices_t<0, I...>
+      {
+         typedef Indices_t<I...> type;
+      };
+
+      template <typename Gens, std::size_t... I>
+      static std::tuple<typename std::tuple_element<I, Gens>::type::value_type...>
+      generate( const Gens & i_gens, Random & io_rng, Indices_t<I...> )
+      {
+         // Braces evaluate left to right, keeping cases reproducible.
+         return std::tuple<typename std::tuple_element<I, Gens>::type::value_type...>
+         {
+            std::get<I>( i_gens )( io_rng )...
+         };
+      }
+
+      // True when i_predicate does not hold for the values, or throws.
+      template <typename P, typename Values, std::size_t... I>
+      static bool fails( P & i_predicate, const Values & i_values, Indices_t<I...> )
+      {
+         try
+         {
+            return !i_predicate( std::get<I>( i_values )... );
+         }
+         catch ( ... )
+         {
+            return true;
+         }
+      }
+
+      template <typename Values, std::size_t... I>
+      static std::string describe_all( const Values & i_values, Indices_t<I...> )
+      {
+         std::string text;
+         const std::string parts[] = { describe( std::get<I>( i_values ), 0 )... };
+
+         for ( std::size_t i = 0; i < sizeof...( I ); ++i )
+         {
+            text += ( i ? ", " : "" ) + parts[i];
+         }
+
+         return text;
+      }
+
+      // Replace value K onwards with the first simpler value that still fails.
+      template <std::size_t K, typename Values, typename Gens, typename F>
+      static typename std::enable_if < ( K == std::tuple_size<Values>::value ), bool >::type
+      shrink_once( Values &, const Gens &, F & )
+      {
+         return false;
+      }
+      template <std::size_t K, typename Values, typename Gens, typename F>
+      static typename std::enable_if < ( K < std::tuple_size<Values>::value ), bool >::type
+      shrink_once( Values & io_values, const Gens & i_gens, F & i_fails )
+      {
+         typedef typename std::tuple_element<K, Values>::type value_t;
+         const std::vector<value_t> simpler = std::get<K>( i_gens ).shrink( std::get<K>( io_values ) );
+
+         for ( std::size_t i = 0; i < simpler.size(); ++i )
+         {
+            Values trial( io_values );
+            std::get<K>( trial ) = simpler[i];
+
+            if ( i_fails( trial ) )
+            {
+               io_values = trial;
+               return true;
+            }
+         }
+
+         return shrink_once < K + 1 > ( io_values, i_gens, i_fails );
+      }
+
+      template <typename P, typename... G>
+      void property_check( P i_predicate, const std::size_t i_count, const G &... i_gens )
+      {
+         typedef std::tuple<G...> gens_t;
+         typedef std::tuple<typename G::value_type...> values_t;
+         typedef typename MakeIndices_t<sizeof...( G )>::type indices_t;
+
+         Fixture fix( this );
+
+         const gens_t gens( i_gens... );
+         const uint64_t seed = test_seed();
+         const std::size_t batch = 1024;
+         const std::size_t none = ~std::size_t( 0 );
+         std::atomic<std::size_t> failed( none );
+
+         for ( std::size_t first = 0; first < i_count && failed == none; first += batch )
+         {
+            const std::size_t size = i_count - first < batch ? i_count - first : batch;
+
+            parallel_for( size, [&]( const std::size_t i_begin, const std::size_t i_end )
+            {
+               for ( std::size_t i = first + i_begin; i < first + i_end && i < failed; ++i )
+               {
+                  Random rng = Random::stream( seed, i );
+                  const values_t values = generate( gens, rng, indices_t() );
+
+                  if ( fails( i_predicate, values, indices_t() ) )
+                  {
+                     atomic_min( failed, i );
+                  }
+               }
+            } );
+         }
+
+         std::ostringstream note;
+
+         if ( failed == none )
+         {
+            note << "Property: " << i_count << " cases passed (seed " << seed << ")";
+            test_note = note.str();
+            test_status_pass();
+            return;
+         }
+
+         Random rng = Random::stream( seed, failed );
+         values_t values = generate( gens, rng, indices_t() );
+         const std::string original = describe_all( values, indices_t() );
+
+         std::size_t steps = 0;
+         std::size_t tries = 0;
+         auto still_fails = [&]( const values_t & i_values ) -> bool
+         {
+            ++tries;
+            return fails( i_predicate, i_values, indices_t() );
+         };
+
+         while ( tries < 10000 && shrink_once<0>( values, gens, still_fails ) )
+         {
+            ++steps;
+         }
+
+         note << "Property: case " << failed << " of " << i_count << " failed (seed " << seed << ")\n"
+              << "      input:  " << original << "\n"
+              << "      shrunk: " << describe_all( values, indices_t() )
+              << " (" << steps << " steps)";
+         test_note = note.str();
+         test_status_fail();
+      }
+#endif
+
+#ifdef MICRO_TEST_TIMING
+      // Holds one value, keeps std::vector<bool> packing out of parallel writes.
+      template <typename T>
+      struct Slot_t
+      {
+         T value;
+      };
+
+      struct Equal_t
+      {
+         template <typename A, typename B>
+         bool operator()( const A & i_a, const B & i_b ) const
+         {
+            return i_a == i_b;
+         }
+      };
+#endif
+
+#ifdef MICRO_TEST_ROWS
+      // Contents of a data file, memory mapped where the platform allows,
+      // read into memory otherwise.
+      class MappedFile_t
+      {
+         std::vector<char> copy;
+         void * mapping;
+
+         MappedFile_t( const MappedFile_t & ) = delete;
+         MappedFile_t & operator=( const MappedFile_t & ) = delete;
+
+      public:
+         const char * data;
+         std::size_t size;
+         bool ok;
+
+         explicit MappedFile_t( const std::string & i_path )
+            : mapping{}, data{}, size{}, ok{}
+         {
+#ifdef MICRO_TEST_POSIX
+            const int fd = open( i_path.c_str(), O_RDONLY );
+            struct stat info;
+
+            if ( fd < 0 )
+            {
+               return;
+            }
+
+            if ( fstat( fd, &info ) == 0 )
+            {
+               size = static_cast<std::size_t>( info.st_size );
+               mapping = size ? mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 ) : nullptr;
+               ok = mapping != MAP_FAILED;
+
+               if ( ok && mapping )
+               {
+                  madvise( mapping, size, MADV_SEQUENTIAL );
+                  data = static_cast<const char *>( mapping );
+               }
+               else if ( !ok )
+               {
+                  mapping = nullptr;
+                  size = 0;
+               }
+            }
+
+            close( fd );
+#else
+            std::ifstream in( i_path.c_str(), std::ios::binary | std::ios::ate );
+            ok = in.is_open();
+            copy.resize( ok ? static_cast<std::size_t>( in.tellg() ) : 0 );
+            in.seekg( 0 );
+            in.read( copy.empty() ? nullptr : &copy[0], static_cast<std::streamsize>( copy.size() ) );
+            size = copy.size();
+            data = size ? &copy[0] : nullptr;
+#endif
+         }
+
+         ~MappedFile_t()
+         {
+#ifdef MICRO_TEST_POSIX
+            if ( mapping )
+            {
+               munmap( mapping, size );
+            }
+#endif
+         }
+      };
+
+      // Rows of one slice of a data file and how many failed.
+      struct RowChunk_t
+      {
+         const char * first;   // CSV text of the slice.
+         const char * last;
+         std::size_t line;     // Lines or records before the slice, then the one being checked.
+         std::size_t rows;     // Rows checked.
+         std::size_t failed;
+         std::vector<std::size_t> failures;  // First few failing rows, numbered in the file.
+      };
+
+      enum { ROW_FAILURES_SHOWN = 10 };
+
+      template <typename F, typename R>
+      static void row_check( F & i_fn, const R & i_row, RowChunk_t & io_chunk )
+      {
+         bool passed = false;
+         ++io_chunk.rows;
+
+         try
+         {
+            passed = i_fn( i_row );
+         }
+         catch ( ... )
+         {
+         }
+
+         if ( !passed && io_chunk.failed++ < ROW_FAILURES_SHOWN )
+         {
+            io_chunk.failures.push_back( io_chunk.line );
+         }
+      }
+
+      // CSV, each slice ends at a line end. Blank lines and lines starting
+      // with '#' are skipped.
+      template <typename F>
+      static void row_read( const MappedFile_t & i_file, const char i_delimiter, F & i_fn,
+                            std::vector<RowChunk_t> & io_chunks, Row * )
+      {
+         const char * const end = i_file.data + i_file.size;
+         const char * at = i_file.data;
+
+         for ( std::size_t c = 0; c < io_chunks.size(); ++c )
+         {
+            const char * const cut = i_file.data + i_file.size * ( c + 1 ) / io_chunks.size();
+            const char * const newline = cut > at && cut < end ? static_cast<const char *>(
+                                            std::memchr( cut, '\n', static_cast<std::size_t>( end - cut ) ) ) : nullptr;
+
+            io_chunks[c].first = at;
+            at = newline ? newline + 1 : cut > at ? end : at;
+            io_chunks[c].last = c + 1 == io_chunks.size() ? end : at;
+         }
+
+         // Each slice numbers its rows from the lines before it, so count the
+         // lines of every slice first.
+         if ( io_chunks.size() > 1 )
+         {
+            parallel_for( io_chunks.size(), [&]( const std::size_t i_begin, const std::size_t i_end )
+            {
+               for ( std::size_t c = i_begin; c < i_end; ++c )
+               {
+                  const char * const first = io_chunks[c].first;
+                  const char * const last = io_chunks[c].last;
+                  io_chunks[c].line = static_cast<std::size_t>( std::count( first, last, '\n' ) );
+               }
+            } );
+
+            std::size_t lines = 0;
+
+            for ( std::size_t c = 0; c < io_chunks.size(); ++c )
+            {
+               std::swap( lines, io_chunks[c].line );
+               lines += io_chunks[c].line;
+            }
+         }
+
+         parallel_for( io_chunks.size(), [&]( const std::size_t i_begin, const std::size_t i_end )
+         {
+            Row row( i_delimiter );
+
+            for ( std::size_t c = i_begin; c < i_end; ++c )
+            {
+               RowChunk_t & chunk = io_chunks[c];
+
+               for ( const char * line = chunk.first; line < chunk.last; )
+               {
+                  const char * const newline = static_cast<const char *>(
+                                                  std::memchr( line, '\n', static_cast<std::size_t>( chunk.last - line ) ) );
+                  const char * stop = newline ? newline : chunk.last;
+                  ++chunk.line;
+
+                  if ( stop > line && stop[-1] == '\r' )
+                  {
+                     --stop;
+                  }
+
+                  if ( stop > line && *line != '#' )
+                  {
+                     row.assign( line, stop, chunk.line );
+                     row_check( i_fn, row, chunk );
+                  }
+
+                  line = newline ? newline + 1 : chunk.last;
+               }
+            }
+         } );
+      }
+
+      // Binary, fixed size records of T.
+      template <typename F, typename T>
+      static void row_read( const MappedFile_t & i_file, const char, F & i_fn,
+                            std::vector<RowChunk_t> & io_chunks, T * )
+      {
+         static_assert( std::is_trivially_copyable<T>::value,
+                        "each_row records must be trivially copyable" );
+
+         const T * const records = reinterpret_cast<const T *>( i_file.data );
+         const std::size_t count = i_file.size / sizeof( T );
+
+         parallel_for( io_chunks.size(), [&]( const std::size_t i_begin, const std::size_t i_end )
+         {
+            for ( std::size_t c = i_begin; c < i_end; ++c )
+            {
+               RowChunk_t & chunk = io_chunks[c];
+               const std::size_t last = count * ( c + 1 ) / io_chunks.size();
+
+               for ( std::size_t i = count * c / io_chunks.size(); i < last; ++i )
+               {
+                  chunk.line = i + 1;
+                  row_check( i_fn, records[i], chunk );
+               }
+            }
+         } );
+      }
+#endif
+
+#if defined( MICRO_TEST_POSIX ) && ( defined( MICRO_TEST_DEATH ) || defined( MICRO_TEST_FUZZ ) )
+      // Exit code of a child whose callable threw, instead of unwinding back
+      // into the test program.
+      enum { CHILD_THREW = 250 };
+
+      // How a callable run in a child process ended.
+      struct ChildResult_t
+      {
+         bool exited;      // true on normal exit, false if killed by a signal.
+         int status;       // Exit code, or the terminating signal number.
+         bool threw;       // Exited with CHILD_THREW.
+         bool timed_out;   // Still running after the timeout and killed.
+         std::string err;  // Everything the child wrote to stderr.
+      };
+
+      // Fork (without exec) and run i_fn in the child, capturing its stderr.
+      // A child that returns from i_fn exits with status 0, one that throws
+      // exits with CHILD_THREW. A child still running after i_seconds is
+      // killed.
+      ChildResult_t run_in_child( const lambda_t & i_fn, const double i_seconds )
+      {
+         typedef std::chrono::steady_clock clock_t;
+
+         ChildResult_t result = { false, -1, false, false, "" };
+         int fd[2];
+
+         // Don't let the child flush output buffered by the parent.
+         std::cout.flush();
+         clog.flush();
+         std::fflush( nullptr );
+
+         if ( pipe( fd ) != 0 )
+         {
+            return result;
+         }
+
+         const pid_t pid = fork();
+
+         if ( pid < 0 )
+         {
+            close( fd[0] );
+            close( fd[1] );
+            return result;
+         }
+
+         profile_forked = true;
+
+         if ( pid == 0 )
+         {
+            // Expected crashes should not leave core files behind.
+            struct rlimit no_core = { 0, 0 };
+            setrlimit( RLIMIT_CORE, &no_core );
+
+            close( fd[0] );
+            dup2( fd[1], STDERR_FILENO );
+            close( fd[1] );
+            std::cerr.rdbuf( cerr_buf );
+
+            int code = 0;
+
+            // An exception must not unwind into the rest of the test suite.
+            try
+            {
+               i_fn();
+            }
+            catch ( const std::exception & ex )
+            {
+               std::cerr << "Uncaught exception: " << ex.what() << std::endl;
+               code = CHILD_THREW;
+            }
+            catch ( ... )
+            {
+               std::cerr << "Uncaught exception" << std::endl;
+               code = CHILD_THREW;
+            }
+
+            std::cerr.flush();
+            std::fflush( nullptr );
+            _exit( code );
+         }
+
+         close( fd[1] );
+
+         const clock_t::time_point deadline = clock_t::now() +
+                                              std::chrono::microseconds( static_cast<long long>( i_seconds * 1e6 ) );
+         char buffer[512];
+
+         for ( ;; )
+         {
+            const long long left_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         deadline - clock_t::now() ).count();
+
+            if ( left_ms <= 0 )
+            {
+               result.timed_out = true;
+               break;
+            }
+
+            struct pollfd ready = { fd[0], POLLIN, 0 };
+
+            if ( poll( &ready, 1, left_ms < 1000 ? static_cast<int>( left_ms ) + 1 : 1000 ) <= 0 )
+            {
+               continue;
+            }
+
+            const ssize_t n = read( fd[0], buffer, sizeof buffer );
+
+            if ( n > 0 )
+            {
+               result.err.append( buffer, static_cast<std::size_t>( n ) );
+            }
+            else if ( n == 0 || errno != EINTR )
+            {
+               break;
+            }
+         }
+
+         close( fd[0] );
+
+         // The child may close stderr and keep running.
+         int status = 0;
+         pid_t done = 0;
+
+         while ( !result.timed_out && done == 0 )
+         {
+            done = waitpid( pid, &status, WNOHANG );
+
+            if ( done < 0 && errno == EINTR )
+            {
+               done = 0;
+            }
+            else if ( done == 0 && clock_t::now() >= deadline )
+            {
+               result.timed_out = true;
+            }
+            else if ( done == 0 )
+            {
+               poll( nullptr, 0, 1 );
+            }
+         }
+
+         if ( result.timed_out )
+         {
+            kill( pid, SIGKILL );
+
+            while ( waitpid( pid, &status, 0 ) < 0 && errno == EINTR )
+            {
+            }
+         }
+
+         if ( WIFEXITED( status ) )
+         {
+            result.exited = true;
+            result.status = WEXITSTATUS( status );
+            result.threw = result.status == CHILD_THREW;
+         }
+         else if ( WIFSIGNALED( status ) )
+         {
+            result.status = WTERMSIG( status );
+         }
+
+         return result;
+      }
+
+      // Why a child run by a death test did not end as one, or empty.
+      static std::string child_note( const ChildResult_t & i_child, const double i_seconds )
+      {
+         std::ostringstream note;
+
+         if ( i_child.timed_out )
+         {
+            note << "Death: still running after " << i_seconds << "s, killed";
+         }
+         else if ( i_child.threw )
+         {
+            note << "Death: " << i_child.err.substr( 0, i_child.err.find( '\n' ) );
+         }
+
+         return note.str();
+      }
+
+#ifdef MICRO_TEST_FUZZ
+      enum { FUZZ_MAX_INPUT = 4096 };
+
+      // Fuzzer state shared with the child process running the fuzz loop.
+      // The input being run is kept here, so it survives a crash.
+      struct FuzzShared_t
+      {
+         uint64_t execs;
+         uint32_t edges;
+         uint32_t corpus;
+         uint32_t done;
+         uint32_t size;
+         uint8_t data[FUZZ_MAX_INPUT];
+      };
+
+      // Every file in i_dir as a fuzz input.
+      static std::vector<std::vector<uint8_t>> fuzz_load( const std::string & i_dir )
+      {
+         std::vector<std::vector<uint8_t>> inputs;
+         DIR * const dir = i_dir.empty() ? nullptr : opendir( i_dir.c_str() );
+
+         if ( !dir )
+         {
+            return inputs;
+         }
+
+         while ( struct dirent * entry = readdir( dir ) )
+         {
+            if ( entry->d_name[0] == '.' )
+            {
+               continue;
+            }
+
+            std::ifstream in( ( i_dir + "/" + entry->d_name ).c_str(), std::ios::binary );
+            std::vector<uint8_t> input( FUZZ_MAX_INPUT );
+            in.read( reinterpret_cast<char *>( &input[0] ), FUZZ_MAX_INPUT );
+            input.resize( static_cast<std::size_t>( in.gcount() ) );
+
+            if ( in.gcount() > 0 || in.eof() )
+            {
+               inputs.push_back( input );
+            }
+         }
+
+         closedir( dir );
+         return inputs;
+      }
+
+      // Write an input to i_dir, named by a hash of its bytes.
+      static std::string fuzz_save( const std::string & i_dir, const std::string & i_prefix,
+                                    const uint8_t * i_data, const std::size_t i_size )
+      {
+         uint64_t hash = 0xcbf29ce484222325ULL;
+
+         for ( std::size_t i = 0; i < i_size; ++i )
+         {
+            hash = ( hash ^ i_data[i] ) * 0x100000001b3ULL;
+         }
+
+         char name[32];
+         std::snprintf( name, sizeof name, "%016llx", static_cast<unsigned long long>( hash ) );
+
+         const std::string path = i_dir + "/" + i_prefix + name;
+         std::ofstream out( path.c_str(), std::ios::binary );
+         out.write( reinterpret_cast<const char *>( i_data ), static_cast<std::streamsize>( i_size ) );
+         return path;
+      }
+
+      // Apply one random mutation to io_data, returns the new size.
+      static uint32_t fuzz_mutate( Random & io_rng, uint8_t * io_data, uint32_t i_size,
+                                   const std::vector<uint8_t> & i_other )
+      {
+         static const uint8_t interesting[] = { 0, 1, 0x7f, 0x80, 0xff, ' ', '0', '\n' };
+         const uint64_t r = io_rng();
+         unsigned op = static_cast<unsigned>( r % 8 );
+         const uint32_t at = i_size ? static_cast<uint32_t>( ( r >> 8 ) % i_size ) : 0;
+
+         // Empty input can only grow.
+         if ( i_size == 0 && op != 7 )
+         {
+            op = 3;
+         }
+
+         switch ( op )
+         {
+         case 0:
+            io_data[at] ^= static_cast<uint8_t>( 1u << ( ( r >> 40 ) % 8 ) );
+            break;
+
+         case 1:
+            io_data[at] = static_cast<uint8_t>( r >> 40 );
+            break;
+
+         case 2:
+            io_data[at] = interesting[( r >> 40 ) % sizeof interesting];
+            break;
+
+         case 3:
+            if ( i_size < FUZZ_MAX_INPUT )
+            {
+               std::memmove( io_data + at + 1, io_data + at, i_size - at );
+               // Mostly printable, most parsers read text.
+               io_data[at] = static_cast<uint8_t>( ( r >> 40 ) & 1 ? ' ' + ( r >> 41 ) % 95 : r >> 48 );
+               ++i_size;
+            }
+            break;
+
+         case 4:
+         {
+            const uint32_t count = 1 + static_cast<uint32_t>( ( r >> 40 ) % 4 );
+            const uint32_t n = count < i_size - at ? count : i_size - at;
+            std::memmove( io_data + at, io_data + at + n, i_size - at - n );
+            i_size -= n;
+            break;
+         }
+
+         case 5:
+            io_data[at] = static_cast<uint8_t>( io_data[at] + ( r >> 40 ) % 35 - 17 );
+            break;
+
+         case 6:
+         {
+            const uint32_t from = static_cast<uint32_t>( ( r >> 24 ) % i_size );
+            const uint32_t length = static_cast<uint32_t>( ( r >> 40 ) % ( i_size - ( at > from ? at : from ) ) + 1 );
+            std::memmove( io_data + at, io_data + from, length );
+            break;
+         }
+
+         case 7:
+         {
+            // Splice, keep a prefix and append a suffix of another input.
+            if ( i_other.empty() )
+            {
+               break;
+            }
+
+            const uint32_t from = static_cast<uint32_t>( ( r >> 24 ) % i_other.size() );
+            uint32_t length = static_cast<uint32_t>( i_other.size() - from );
+
+            if ( at + length > FUZZ_MAX_INPUT )
+            {
+               length = FUZZ_MAX_INPUT - at;
+            }
+
+            std::memcpy( io_data + at, &i_other[from], length );
+            i_size = at + length;
+            break;
+         }
+         } // switch
+
+         return i_size;
+      }
+
+      // Fold the hit counts of the last run into io_seen, by edge and a
+      // power of two bucket of its count. Returns true for new coverage.
+      MICRO_TEST_NO_COVERAGE
+      static bool fuzz_novel( std::vector<uint8_t> & io_seen, uint32_t & io_edges )
+      {
+         const uint8_t * const hits = Coverage::counters();
+         bool novel = false;
+
+         for ( std::size_t word = 0; word < Coverage::SIZE; word += 8 )
+         {
+            uint64_t any;
+            std::memcpy( &any, hits + word, sizeof any );
+
+            for ( std::size_t i = word; any && i < word + 8; ++i )
+            {
+               const uint8_t n = hits[i];
+               const uint8_t bucket = n == 0 ? 0 : n < 3 ? n : n == 3 ? 4 : n < 8 ? 8 :
+                                      n < 16 ? 16 : n < 32 ? 32 : n < 128 ? 64 : 128;
+
+               if ( bucket & ~io_seen[i] )
+               {
+                  io_edges += io_seen[i] == 0;
+                  io_seen[i] |= bucket;
+                  novel = true;
+               }
+            }
+         }
+
+         return novel;
+      }
+
+      // Run mutated inputs through i_fn until i_seconds pass, in the child.
+      // Inputs reaching new coverage join the corpus, without coverage one
+      // input in 256 is kept so inputs can still grow.
+      MICRO_TEST_NO_COVERAGE
+      void fuzz_loop( const fuzz_lambda_t & i_fn, const double i_seconds,
+                      const std::string & i_dir, FuzzShared_t & io_shared )
+      {
+         std::vector<std::vector<uint8_t>> corpus = fuzz_load( i_dir );
+         std::vector<uint8_t> seen( Coverage::SIZE );
+         uint8_t * const hits = Coverage::counters();
+         Random rng( test_seed() );
+
+         if ( corpus.empty() )
+         {
+            corpus.push_back( std::vector<uint8_t>() );
+         }
+
+         // Seeds first, only inputs adding to their coverage are kept.
+         for ( std::size_t i = 0; i < corpus.size(); ++i )
+         {
+            io_shared.size = static_cast<uint32_t>( corpus[i].size() );
+            std::copy( corpus[i].begin(), corpus[i].end(), io_shared.data );
+            std::memset( hits, 0, Coverage::SIZE );
+            i_fn( io_shared.data, io_shared.size );
+            ++io_shared.execs;
+            fuzz_novel( seen, io_shared.edges );
+         }
+
+         io_shared.corpus = static_cast<uint32_t>( corpus.size() );
+
+         const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() +
+               std::chrono::microseconds( static_cast<long long>( i_seconds * 1e6 ) );
+
+         for ( uint64_t n = 0; ( n & 15 ) || std::chrono::steady_clock::now() < end; ++n )
+         {
+            const std::vector<uint8_t> & parent = corpus[rng() % corpus.size()];
+            const std::vector<uint8_t> & other = corpus[rng() % corpus.size()];
+            uint32_t size = static_cast<uint32_t>( parent.size() );
+
+            std::copy( parent.begin(), parent.end(), io_shared.data );
+
+            for ( uint64_t k = 1 + rng() % 4; k > 0; --k )
+            {
+               size = fuzz_mutate( rng, io_shared.data, size, other );
+            }
+
+            io_shared.size = size;
+            std::memset( hits, 0, Coverage::SIZE );
+            i_fn( io_shared.data, size );
+            ++io_shared.execs;
+
+            const bool keep = io_shared.edges ? fuzz_novel( seen, io_shared.edges )
+                                              : ( n & 255 ) == 0 && corpus.size() < 1024;
+
+            if ( keep )
+            {
+               corpus.push_back( std::vector<uint8_t>( io_shared.data, io_shared.data + size ) );
+               io_shared.corpus = static_cast<uint32_t>( corpus.size() );
+
+               if ( io_shared.edges && !i_dir.empty() )
+               {
+                  fuzz_save( i_dir, "", io_shared.data, size );
+               }
+            }
+         }
+
+         io_shared.done = 1;
+      }
+
+      // Run i_input through i_fn in a child process.
+      ChildResult_t fuzz_run( const fuzz_lambda_t & i_fn, const std::vector<uint8_t> & i_input )
+      {
+         return run_in_child( [&]
+         {
+            alarm( 10 );
+            const uint8_t none = 0;
+            i_fn( i_input.empty() ? &none : &i_input[0], i_input.size() );
+         }, 15 );
+      }
+
+      // Remove chunks of a crashing input while it still ends the same way,
+      // halving the chunk size down to single bytes. Returns the last crash.
+      ChildResult_t fuzz_minimize( const fuzz_lambda_t & i_fn, std::vector<uint8_t> & io_input,
+                                   const ChildResult_t & i_crash )
+      {
+         ChildResult_t last = fuzz_run( i_fn, io_input );
+         std::size_t tries = 0;
+
+         if ( last.exited != i_crash.exited || last.status != i_crash.status )
+         {
+            return i_crash;
+         }
+
+         for ( std::size_t chunk = io_input.size() / 2; chunk > 0; chunk /= 2 )
+         {
+            for ( std::size_t at = 0; at + chunk <= io_input.size() && tries < 1000; ++tries )
+            {
+               std::vector<uint8_t> candidate( io_input );
+               candidate.erase( candidate.begin() + at, candidate.begin() + at + chunk );
+
+               const ChildResult_t result = fuzz_run( i_fn, candidate );
+
+               if ( result.exited == i_crash.exited && result.status == i_crash.status )
+               {
+                  io_input.swap( candidate );
+                  last = result;
+               }
+               else
+               {
+                  at += chunk;
+               }
+            }
+         }
+
+         return last;
+      }
+#endif
+#endif
+
+   public:
+#ifdef MICRO_TEST_TIMING
+      // Growth rates for TestRunner::complexity, in increasing order.
+      enum Complexity_e { O_1, O_LOG_N, O_N, O_N_LOG_N, O_N_SQUARED };
+#endif
+
+      explicit TestRunner( const int i_argc = 1,
+                           const char * const i_argv[] = nullptr )
+         : pass{}
+         , fail{}
+         , memory_mode{}
+         , leak_mode( Leaks::installed() )
+         , leak_row( NO_ROW )
+         , settle_row( NO_ROW )
+         , settle_index{}
+         , deferred_mode{}
+         , test_index{}
+         , profile_mode{}
+         , profile_ms{}
+         , profile_forked{}
+         , bench_env{}
+         , bench_nice{}
+         , bench_strict{}
+         , bench_throttles{}
+         , seed_set{}
+         , seed_value{}
+         , stream_fd( -1 )
+         , stream_used{}
+         , stream_dropped{}
+         , repeat_count( 1 )
+         , repeat_jobs( 1 )
+         , repeat_cv( 0.25 )
+         , repeat_fd( -1 )
+         , repeat_run{}
+         , format( RF_NONE )
+         , format_file{}
+         , format_header( -1 )
+         , format_ms{}
+         , setup{}
+         , cleanup{}
+         , test_elapsed_ms{}
+         , timing{}
+      {
+         program_arguments( i_argc, i_argv );
+
+         // Reading the clock is most of the cost of a check, skip it when
+         // nothing shows the times.
+         timing = timing || profile_mode || format != RF_NONE || repeat_count > 1
+#ifdef MICRO_TEST_POSIX
+                  || stream_fd >= 0
+#endif
+                  ;
+
+#ifdef MICRO_TEST_REPORTS
+#ifdef MICRO_TEST_POSIX
+         if ( repeat_count > 1 )
+         {
+            repeat_suite();
+         }
+#endif
+
+         // Not written in repeat mode, every worker would write one.
+         if ( format != RF_NONE && repeat_fd < 0 )
+         {
+            format_open();
+         }
+#endif
+
+         // Capture cerr, don't want test output polluted.
+         cerr_buf = std::cerr.rdbuf( &err_out );
+         banner();
+
+#if defined( __linux__ ) && defined( MICRO_TEST_TIMING )
+         if ( bench_env )
+         {
+            bench_setup();
+         }
+#endif
+      }
+
+      virtual ~TestRunner()
+      {
+         if ( Leaks::installed() )
+         {
+            leak_next( false );
+            leak_settle();
+         }
+
+#if defined( MICRO_TEST_BACKTRACE ) && defined( MICRO_TEST_REPORTS )
+         if ( profile_mode )
+         {
+            profile_timer( false );
+         }
+#endif
+
+         if ( deferred_mode )
+         {
+            for ( std::size_t i = 0; i < results.size(); ++i )
+            {
+               report_result( i );
+            }
+         }
+
+         clog << "==============================================\n";
+         clog << "Test Summary: Tests(" << pass + fail << ") "
+              << "Passed(" << pass << ") "
+              << "Failed(" << fail << ")\n" << std::endl;
+
+#ifdef MICRO_TEST_REPORTS
+         if ( format_file )
+         {
+            format_close();
+         }
+
+#ifdef MICRO_TEST_POSIX
+         if ( stream_fd >= 0 )
+         {
+            stream_summary();
+            stream_close();
+         }
+#endif
+#endif
+         // Restore cerr
+         std::cerr.rdbuf( cerr_buf );
+      }
+
+      // Turn the leak checker on or off from the next test, it is on when
+      // MICRO_TEST_LEAK_CHECK is defined in one of the program's files.
+      void leaks( const bool i_on )
+      {
+         leak_mode = i_on && Leaks::installed();
+      }
+
+      // Outcome of every check made so far.
+      const ResultTable & result_table() const
+      {
+         return results;
+      }
+
+      void should_pass() const
+      {
+         if ( test_result == false )
+         {
+            clog << "Error! Unexpected test result!" << std::endl;
+            std::exit( 1 );
+         }
+      }
+      void should_fail() const
+      {
+         if ( test_result == true )
+         {
+            clog << "Error! Unexpected test result!" << std::endl;
+            std::exit( 1 );
+         }
+      }
+
+      // Keeps the std::string for a literal description out of each test block.
+      void operator=( const char * const i_message )
+      {
+         start_test( i_message, std::strlen( i_message ) );
+      }
+
+      void operator=( const std::string & i_message )
+      {
+         start_test( i_message.data(), i_message.size() );
+      }
+
+      void operator()( const bool i_flag )
+      {
+         check( i_flag );
+      }
+
+      void fixture( const lambda_t i_setup = nullptr,
+                    const lambda_t i_cleanup = nullptr )
+      {
+         setup = i_setup;
+         cleanup = i_cleanup;
+      }
+
+      //======================
+      // Equality Test Helper
+      //======================
+      template <typename T>
+      void t( T i_v )
+      {
+         check( i_v == true );
+      }
+      template <typename T>
+      void f( T i_v )
+      {
+         check( i_v == false );
+      }
+      template <typename T>
+      void eq( T i_l, T i_r )
+      {
+         check( i_l == i_r );
+      }
+      template <typename T>
+      void ne( T i_l, T i_r )
+      {
+         check( i_l != i_r );
+      }
+      template <typename T>
+      void lt( T i_l, T i_r )
+      {
+         check( i_l < i_r );
+      }
+      template <typename T>
+      void gt( T i_l, T i_r )
+      {
+         check( i_l > i_r );
+      }
+      template <typename T>
+      void le( T i_l, T i_r )
+      {
+         check( i_l <= i_r );
+      }
+      template <typename T>
+      void ge( T i_l, T i_r )
+      {
+         check( i_l >= i_r );
+      }
+
+      template <typename... Args>
+      void all( Args... i_args )
+      {
+         const int size = sizeof...( i_args );
+         bool status[size] = {i_args...};
+
+         for ( int i = 0; i < size; ++i )
+         {
+            if ( !status[i] )
+            {
+               check( false );
+               return;
+            }
+         }
+
+         check( true );
+      }
+
+      //==========================
+      // String Comparison Helpers
+      //==========================
+      void eq( const std::string & i_s1, const std::string & i_s2 )
+      {
+         check( i_s1.compare( i_s2 ) == 0 );
+      }
+      void eq( const char * const i_s1, const char * const i_s2 )
+      {
+         check( std::string( i_s1 ).compare( i_s2 ) == 0 );
+      }
+      void ne( const std::string & i_s1, const std::string & i_s2 )
+      {
+         check( i_s1.compare( i_s2 ) != 0 );
+      }
+      void ne( const char * const i_s1, const char * const i_s2 )
+      {
+         check( std::string( i_s1 ).compare( i_s2 ) != 0 );
+      }
+
+      //======================
+      // Exception Test Helper
+      //======================
+
+      // The callable is a template parameter rather than a std::function,
+      // a lambda then costs one small instantiation to compile.
+
+      // Test exception T is thrown.
+      template <typename T, typename F>
+      void ex( F i_fn )
+      {
+         exception<T>( i_fn, true );
+      }
+      // Test exception T is never thrown.
+      template <typename T, typename F>
+      void ex_not( F i_fn )
+      {
+         exception<T>( i_fn, false );
+      }
+      // Test any exception is thrown.
+      template <typename F>
+      void ex_any( F i_fn )
+      {
+         Fixture fix( this );
+
+         try
+         {
+            i_fn();
+            test_status_fail();
+         }
+         catch ( ... )
+         {
+            test_status_pass();
+         }
+      }
+      // Test no exception is ever thrown of any type.
+      template <typename F>
+      void ex_none( F i_fn )
+      {
+         Fixture fix( this );
+
+         try
+         {
+            i_fn();
+            test_status_pass();
+         }
+         catch ( ... )
+         {
+            test_status_fail();
+         }
+      }
+
+#ifdef MICRO_TEST_PROPERTY
+      //=====================
+      // Property Test Helper
+      //=====================
+
+      // Test i_predicate( values... ) returns true for i_count cases made by
+      // the MicroTest::Gen generators. Cases are run in batches across all
+      // cores, so the predicate must be safe to call in parallel. A failing
+      // case is shrunk to a simpler one that still fails.
+      template <typename G1, typename P>
+      void property( const G1 & i_gen1, P i_predicate, const std::size_t i_count )
+      {
+         property_check( i_predicate, i_count, i_gen1 );
+      }
+      template <typename G1, typename G2, typename P>
+      void property( const G1 & i_gen1, const G2 & i_gen2, P i_predicate,
+                     const std::size_t i_count )
+      {
+         property_check( i_predicate, i_count, i_gen1, i_gen2 );
+      }
+      template <typename G1, typename G2, typename G3, typename P>
+      void property( const G1 & i_gen1, const G2 & i_gen2, const G3 & i_gen3,
+                     P i_predicate, const std::size_t i_count )
+      {
+         property_check( i_predicate, i_count, i_gen1, i_gen2, i_gen3 );
+      }
+#endif
+
+#ifdef MICRO_TEST_TIMING
+      //========================
+      // Complexity Test Helper
+      //========================
+
+      // Sizes i_first, i_first * i_factor, ... up to i_last.
+      static std::vector<std::size_t> geometric_sizes( const std::size_t i_first,
+                                                       const std::size_t i_last,
+                                                       const std::size_t i_factor = 2 )
+      {
+         std::vector<std::size_t> sizes;
+
+         for ( std::size_t n = i_first; n > 0 && n <= i_last; n *= ( i_factor > 1 ? i_factor : 2 ) )
+         {
+            sizes.push_back( n );
+         }
+
+         return sizes;
+      }
+
+      // Test the run time of i_fn grows no faster than i_expected. For each
+      // size n, i_setup( n ) prepares the input and i_fn is timed on it, the
+      // sizes take turns over 15 rounds. The median timing of each size is
+      // fitted to O(1), O(log n), O(n), O(n log n) and O(n^2), the lowest
+      // growth rate with an RMS error no more than 5 percentage points above
+      // that of the best fit is taken. A size of 0 leaves out the log models.
+      void complexity( const size_lambda_t i_setup, const lambda_t i_fn,
+                       const std::vector<std::size_t> & i_sizes,
+                       const Complexity_e i_expected )
+      {
+         typedef std::chrono::steady_clock clock_t;
+
+         static const char * const names[] = { "O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)" };
+         const int models = 5;
+
+         Fixture fix( this );
+
+         if ( bench_refused() )
+         {
+            return;
+         }
+
+         std::vector<double> times;
+
+#ifdef __linux__
+         const BenchPin_t pin( bench_env ? bench_set : std::vector<int>() );
+#endif
+
+         const auto growth = []( const Complexity_e i_model, const std::size_t i_n ) -> double
+         {
+            const double n = static_cast<double>( i_n );
+
+            switch ( i_model )
+            {
+            case O_1:
+               return 1;
+
+            case O_LOG_N:
+               return std::log2( n );
+
+            case O_N:
+               return n;
+
+            case O_N_LOG_N:
+               return n * std::log2( n );
+
+            default:
+               return n * n;
+            } // switch
+         };
+
+         // Calls per timing of each size, grown until the batch runs long
+         // enough to time.
+         std::vector<std::size_t> calls( i_sizes.size(), 1 );
+         std::vector<std::vector<double>> rounds( i_sizes.size() );
+
+         const auto time_calls = [&]( const std::size_t i_calls )
+         {
+            const clock_t::time_point start = clock_t::now();
+
+            for ( std::size_t i = 0; i < i_calls; ++i )
+            {
+               i_fn();
+            }
+
+            return std::chrono::duration<double>( clock_t::now() - start ).count();
+         };
+
+         // Sizes take turns over 15 rounds, so a burst of noise slows one
+         // round of a few sizes rather than every round of one size.
+         const int turns = 15;
+
+         for ( int round = 0; round < turns; ++round )
+         {
+            for ( std::size_t s = 0; s < i_sizes.size(); ++s )
+            {
+               i_setup( i_sizes[s] );
+               double elapsed = time_calls( calls[s] );
+
+               while ( round == 0 && elapsed < 0.002 && calls[s] < ( std::size_t( 1 ) << 30 ) )
+               {
+                  calls[s] *= 2;
+                  elapsed = time_calls( calls[s] );
+               }
+
+               rounds[s].push_back( elapsed / calls[s] );
+            }
+         }
+
+         // A change of machine speed between rounds scales every size of a
+         // round alike, each round is divided by its geometric mean before
+         // the median of each size is taken, and the median scale is put back.
+         std::vector<double> scales;
+
+         for ( int round = 0; round < turns; ++round )
+         {
+            double log_sum = 0;
+
+            for ( std::size_t s = 0; s < i_sizes.size(); ++s )
+            {
+               log_sum += std::log( std::max( rounds[s][round], 1e-12 ) );
+            }
+
+            scales.push_back( i_sizes.empty() ? 1 : std::exp( log_sum / i_sizes.size() ) );
+
+            for ( std::size_t s = 0; s < i_sizes.size(); ++s )
+            {
+               rounds[s][round] /= scales.back();
+            }
+         }
+
+         std::nth_element( scales.begin(), scales.begin() + turns / 2, scales.end() );
+
+         for ( std::size_t s = 0; s < i_sizes.size(); ++s )
+         {
+            std::nth_element( rounds[s].begin(), rounds[s].begin() + turns / 2, rounds[s].end() );
+            times.push_back( rounds[s][turns / 2] * scales[turns / 2] );
+         }
+
+         double fit[models];
+         double coefficient[models];
+         double mean = 0;
+
+         // log2( 0 ) is -inf, a size of 0 can only be fitted without the log models.
+         const bool log_models = std::find( i_sizes.begin(), i_sizes.end(), std::size_t( 0 ) ) == i_sizes.end();
+         const auto usable = [&]( const int i_model )
+         {
+            return log_models || ( i_model != O_LOG_N && i_model != O_N_LOG_N );
+         };
+
+         for ( std::size_t s = 0; s < times.size(); ++s )
+         {
+            mean += times[s] / times.size();
+         }
+
+         for ( int m = 0; m < models; ++m )
+         {
+            double tf = 0;
+            double ff = 0;
+
+            for ( std::size_t s = 0; s < times.size(); ++s )
+            {
+               const double f = growth( static_cast<Complexity_e>( m ), i_sizes[s] );
+               tf += times[s] * f;
+               ff += f * f;
+            }
+
+            coefficient[m] = ff > 0 ? tf / ff : 0;
+
+            double error = 0;
+
+            for ( std::size_t s = 0; s < times.size(); ++s )
+            {
+               const double residual = times[s] -
+                                       coefficient[m] * growth( static_cast<Complexity_e>( m ), i_sizes[s] );
+               error += residual * residual;
+            }
+
+            fit[m] = times.empty() || mean <= 0 ? 0 : std::sqrt( error / times.size() ) / mean;
+         }
+
+         int best = 0;
+
+         for ( int m = 1; m < models; ++m )
+         {
+            best = usable( m ) && fit[m] < fit[best] ? m : best;
+         }
+
+         for ( int m = 0; m < best; ++m )
+         {
+            // An absolute margin, a relative one is noise at errors of a few %.
+            if ( usable( m ) && fit[m] <= fit[best] + 0.05 )
+            {
+               best = m;
+               break;
+            }
+         }
+
+         std::ostringstream note;
+         note << "Complexity: " << names[best] << ", " << coefficient[best] * 1e9
+              << " ns per unit, RMS error " << fit[best] * 100 << "%, expected "
+              << names[i_expected];
+
+         if ( !log_models )
+         {
+            note << ", log models left out for size 0";
+         }
+
+         test_note = note.str();
+
+         if ( !times.empty() && best <= i_expected )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+      }
+
+      //=========================
+      // Scalability Test Helper
+      //=========================
+
+      // Run i_fn( thread_index ) in a loop on 1, 2, 4, ... i_max_threads
+      // threads for 100 ms each and report throughput, speedup and parallel
+      // efficiency. Test fails when efficiency at i_at_threads (default
+      // i_max_threads) is below i_min_efficiency (0.8 is 80%), or when i_fn
+      // throws.
+      void scaling( const thread_lambda_t i_fn, const unsigned i_max_threads,
+                    const double i_min_efficiency = 0, unsigned i_at_threads = 0 )
+      {
+         typedef std::chrono::steady_clock clock_t;
+
+         Fixture fix( this );
+
+         if ( i_max_threads == 0 )
+         {
+            test_note = "Scaling: max_threads must be at least 1";
+            test_status_fail();
+            return;
+         }
+
+         if ( bench_refused() )
+         {
+            return;
+         }
+
+         if ( i_at_threads == 0 || i_at_threads > i_max_threads )
+         {
+            i_at_threads = i_max_threads;
+         }
+
+         std::vector<unsigned> counts;
+
+         for ( unsigned threads = 1; threads < i_max_threads; threads *= 2 )
+         {
+            counts.push_back( threads );
+         }
+
+         counts.push_back( i_max_threads );
+
+         if ( std::find( counts.begin(), counts.end(), i_at_threads ) == counts.end() )
+         {
+            counts.insert( std::lower_bound( counts.begin(), counts.end(), i_at_threads ), i_at_threads );
+         }
+
+         // Threads started here inherit the pinned set, pinned only when
+         // the CPUs were given, one CPU can't show scaling.
+#ifdef __linux__
+         const bool pinned = bench_env && !bench_cpus.empty();
+         const BenchPin_t pin( pinned ? bench_cpus : std::vector<int>() );
+         const std::size_t available = pinned ? bench_cpus.size() : affinity_cpus().size();
+#else
+         const bool pinned = false;
+         const std::size_t available = std::thread::hardware_concurrency();
+#endif
+
+         std::ostringstream note;
+         note << "Scaling: threads, calls/s, speedup, efficiency";
+
+         if ( available > 0 && i_max_threads > available )
+         {
+            note << "\n      Warning: " << i_max_threads << " threads on " << available
+                 << ( pinned ? " pinned CPU" : " CPU" ) << ( available == 1 ? "" : "s" )
+                 << ", speedup is capped at " << available;
+         }
+
+         double single = 0;
+         double efficiency_at = 0;
+
+         // First exception thrown by i_fn, it stops the measurement.
+         std::mutex error_lock;
+         std::string error;
+         bool threw = false;
+
+         for ( std::size_t c = 0; c < counts.size() && !threw; ++c )
+         {
+            const unsigned threads = counts[c];
+            std::atomic<bool> go( false );
+            std::atomic<bool> stop( false );
+            std::atomic<unsigned long long> calls( 0 );
+            std::vector<std::thread> workers;
+
+            for ( unsigned t = 0; t < threads; ++t )
+            {
+               workers.push_back( std::thread( [&, t]
+               {
+                  unsigned long long done = 0;
+
+                  while ( !go.load( std::memory_order_acquire ) )
+                  {
+                     std::this_thread::yield();
+                  }
+
+                  try
+                  {
+                     while ( !stop.load( std::memory_order_relaxed ) )
+                     {
+                        i_fn( t );
+                        ++done;
+                     }
+                  }
+                  catch ( ... )
+                  {
+                     std::lock_guard<std::mutex> guard( error_lock );
+
+                     if ( !threw )
+                     {
+                        threw = true;
+                        error = describe_error( std::current_exception() );
+                     }
+
+                     stop = true;
+                  }
+
+                  calls += done;
+               } ) );
+            }
+
+            const clock_t::time_point start = clock_t::now();
+            go.store( true, std::memory_order_release );
+            std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+            stop = true;
+
+            for ( std::size_t t = 0; t < workers.size(); ++t )
+            {
+               workers[t].join();
+            }
+
+            if ( threw )
+            {
+               note << "\n      " << threads << " threads, fn threw: " << error;
+               break;
+            }
+
+            const double elapsed = std::chrono::duration<double>( clock_t::now() - start ).count();
+            const double throughput = calls / elapsed;
+
+            if ( c == 0 )
+            {
+               single = throughput;
+            }
+
+            const double speedup = single > 0 ? throughput / single : 0;
+            const double efficiency = speedup / threads;
+
+            if ( threads == i_at_threads )
+            {
+               efficiency_at = efficiency;
+            }
+
+            note << "\n      " << threads << ", " << throughput << ", "
+                 << speedup << "x, " << efficiency * 100 << "%";
+         }
+
+         test_note = note.str();
+
+         if ( !threw && efficiency_at >= i_min_efficiency )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+      }
+
+      //=======================
+      // Differential Test Helper
+      //=======================
+
+      // Test i_candidate returns the same as i_reference for i_count inputs
+      // made by i_gen( MicroTest::Random & ). Inputs are evaluated in batches
+      // across all cores, so both functions must be safe to call in parallel.
+      template <typename G, typename R, typename C>
+      void differential( G i_gen, R i_reference, C i_candidate, const std::size_t i_count )
+      {
+         differential( i_gen, i_reference, i_candidate, i_count, Equal_t() );
+      }
+      // As above, outputs are compared with i_equal( reference, candidate ).
+      template <typename G, typename R, typename C, typename E>
+      void differential( G i_gen, R i_reference, C i_candidate,
+                         const std::size_t i_count, E i_equal )
+      {
+         typedef typename std::decay<decltype( i_gen( std::declval<Random &>() ) )>::type input_t;
+         typedef typename std::decay<decltype( i_reference( std::declval<const input_t &>() ) )>::type reference_t;
+         typedef typename std::decay<decltype( i_candidate( std::declval<const input_t &>() ) )>::type candidate_t;
+         typedef std::chrono::steady_clock clock_t;
+
+         Fixture fix( this );
+
+         const uint64_t seed = test_seed();
+         const std::size_t batch = 16384;
+         const std::size_t none = ~std::size_t( 0 );
+
+         std::vector<Slot_t<input_t> > inputs;
+         std::vector<Slot_t<reference_t> > expected;
+         std::vector<Slot_t<candidate_t> > actual;
+         std::vector<std::exception_ptr> reference_error;
+         std::vector<std::exception_ptr> candidate_error;
+         std::atomic<std::size_t> failed( none );
+         double reference_s = 0;
+         double candidate_s = 0;
+         std::size_t checked = 0;
+
+         for ( std::size_t first = 0; first < i_count && failed == none; first += batch )
+         {
+            const std::size_t size = i_count - first < batch ? i_count - first : batch;
+            inputs.resize( size );
+            expected.resize( size );
+            actual.resize( size );
+            reference_error.resize( size );
+            candidate_error.resize( size );
+
+            parallel_for( size, [&]( const std::size_t i_begin, const std::size_t i_end )
+            {
+               for ( std::size_t i = i_begin; i < i_end; ++i )
+               {
+                  Random rng = Random::stream( seed, first + i );
+                  inputs[i].value = i_gen( rng );
+               }
+            } );
+
+            clock_t::time_point start = clock_t::now();
+            parallel_for( size, [&]( const std::size_t i_begin, const std::size_t i_end )
+            {
+               std::size_t i = i_begin;
+
+               try
+               {
+                  for ( ; i < i_end; ++i )
+                  {
+                     expected[i].value = i_reference( inputs[i].value );
+                  }
+               }
+               catch ( ... )
+               {
+                  reference_error[i] = std::current_exception();
+                  atomic_min( failed, first + i );
+               }
+            } );
+            reference_s += std::chrono::duration<double>( clock_t::now() - start ).count();
+
+            start = clock_t::now();
+            parallel_for( size, [&]( const std::size_t i_begin, const std::size_t i_end )
+            {
+               std::size_t i = i_begin;
+
+               try
+               {
+                  for ( ; i < i_end; ++i )
+                  {
+                     actual[i].value = i_candidate( inputs[i].value );
+                  }
+               }
+               catch ( ... )
+               {
+                  candidate_error[i] = std::current_exception();
+                  atomic_min( failed, first + i );
+               }
+            } );
+            candidate_s += std::chrono::duration<double>( clock_t::now() - start ).count();
+
+            // A slice stops at the input that threw, every input below the
+            // lowest one that threw has both outputs, a lower mismatch wins.
+            for ( std::size_t i = 0; i < size && first + i < failed; ++i )
+            {
+               if ( !i_equal( expected[i].value, actual[i].value ) )
+               {
+                  failed = first + i;
+               }
+            }
+
+            checked += size;
+         }
+
+         std::ostringstream note;
+
+         if ( failed == none )
+         {
+            note << "Differential: " << checked << " inputs match, reference "
+                 << ( reference_s > 0 ? checked / reference_s : 0 ) << "/s, candidate "
+                 << ( candidate_s > 0 ? checked / candidate_s : 0 ) << "/s, speedup "
+                 << ( candidate_s > 0 ? reference_s / candidate_s : 0 ) << "x";
+         }
+         else
+         {
+            const std::size_t i = failed - ( checked - inputs.size() );
+
+            // A function that threw at the input has no value to show.
+            note << "Differential: input " << failed << " (seed " << seed << ") differs\n"
+                 << "      input:     " << describe( inputs[i].value, 0 ) << "\n"
+                 << ( reference_error[i] ? "      reference threw: " + describe_error( reference_error[i] )
+                                         : "      reference: " + describe( expected[i].value, 0 ) ) << "\n"
+                 << ( candidate_error[i] ? "      candidate threw: " + describe_error( candidate_error[i] )
+                                         : "      candidate: " + describe( actual[i].value, 0 ) );
+         }
+
+         test_note = note.str();
+
+         if ( failed == none )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+      }
+#endif
+
+#ifdef MICRO_TEST_ROWS
+      //=========================
+      // Table Driven Test Helper
+      //=========================
+
+      // Test i_fn( row ) returns true for every row of a data file. Rows
+      // of a CSV file (tab separated for .tsv) are given as a MicroTest::Row,
+      // other record types read the file as fixed size binary records,
+      // each_row<Record>( path, fn ). The file is memory mapped and split
+      // into slices, run across all cores when i_parallel is true, so i_fn
+      // must then be safe to call in parallel. An exception thrown by i_fn
+      // fails the row. Failing rows are reported by line number (CSV) or
+      // record number, counting from 1.
+      template <typename T = Row, typename F>
+      void each_row( const std::string & i_path, F i_fn, const bool i_parallel = false )
+      {
+         Fixture fix( this );
+         const MappedFile_t file( i_path );
+         std::ostringstream note;
+
+         if ( !file.ok || file.size % ( std::is_same<T, Row>::value ? 1 : sizeof( T ) ) )
+         {
+            note << "Rows: " << ( file.ok ? "size of " : "can't read " ) << i_path
+                 << ( file.ok ? " is not a multiple of the record size" : "" );
+            test_note = note.str();
+            test_status_fail();
+            return;
+         }
+
+         const std::size_t slices = i_parallel ? 4 * std::max( 1u, std::thread::hardware_concurrency() ) : 1;
+         const char delimiter = i_path.size() > 4 && i_path.compare( i_path.size() - 4, 4, ".tsv" ) == 0 ? '\t' : ',';
+         std::vector<RowChunk_t> chunks( slices, RowChunk_t() );
+
+         row_read( file, delimiter, i_fn, chunks, static_cast<T *>( nullptr ) );
+
+         std::size_t rows = 0;
+         std::size_t failed = 0;
+         std::vector<std::size_t> failures;
+
+         for ( std::size_t c = 0; c < chunks.size(); ++c )
+         {
+            for ( std::size_t i = 0; i < chunks[c].failures.size() && failures.size() < ROW_FAILURES_SHOWN; ++i )
+            {
+               failures.push_back( chunks[c].failures[i] );
+            }
+
+            rows += chunks[c].rows;
+            failed += chunks[c].failed;
+         }
+
+         if ( failed == 0 )
+         {
+            note << "Rows: " << rows << " passed";
+            test_note = note.str();
+            test_status_pass();
+            return;
+         }
+
+         note << "Rows: " << failed << " of " << rows << " failed, at ";
+
+         for ( std::size_t i = 0; i < failures.size(); ++i )
+         {
+            note << ( i ? ", " : "" ) << failures[i];
+         }
+
+         note << ( failed > failures.size() ? ", ..." : "" );
+         test_note = note.str();
+         test_status_fail();
+      }
+#endif
+
+#ifdef MICRO_TEST_MEMORY
+      //=========================
+      // Memory Budget Test Helper
+      //=========================
+
+      // Test the memory i_fn leaves allocated when it returns is no more than
+      // i_bytes. Heap bytes in use are measured where the C library reports
+      // them, otherwise growth of the resident set size.
+      void max_rss( const lambda_t i_fn, const long long i_bytes )
+      {
+         Fixture fix( this );
+         const MemoryUsage_t before = memory_usage();
+
+         i_fn();
+
+         const MemoryUsage_t after = memory_usage();
+         const long long footprint = ( after.heap || before.heap )
+                                     ? after.heap - before.heap
+                                     : after.rss - before.rss;
+
+         std::ostringstream note;
+         note << "Memory footprint " << footprint << " bytes, budget " << i_bytes << " bytes";
+         test_note = note.str();
+
+         if ( footprint <= i_bytes )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+      }
+#endif
+
+#if defined( MICRO_TEST_POSIX ) && defined( MICRO_TEST_DEATH )
+      //==================
+      // Death Test Helper
+      //==================
+
+      // Test i_fn kills the process, by a signal or non-zero exit code,
+      // and i_match (if given) is found in what it wrote to stderr. An
+      // uncaught exception is not a death, and the process is killed and the
+      // test fails if it is still running after i_seconds.
+      void dies( const lambda_t i_fn, const std::string & i_match = "", const double i_seconds = 10 )
+      {
+         Fixture fix( this );
+         const ChildResult_t child = run_in_child( i_fn, i_seconds );
+
+         test_note = child_note( child, i_seconds );
+
+         if ( ( !child.exited || child.status != 0 ) && !child.threw && !child.timed_out &&
+              child.err.find( i_match ) != std::string::npos )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+      }
+
+      // Test i_fn exits the process with exit code i_code.
+      void exits( const lambda_t i_fn, const int i_code, const double i_seconds = 10 )
+      {
+         Fixture fix( this );
+         const ChildResult_t child = run_in_child( i_fn, i_seconds );
+
+         test_note = child_note( child, i_seconds );
+
+         if ( child.exited && child.status == i_code && !child.threw )
+         {
+            test_status_pass();
+         }
+         else
+         {
+            test_status_fail();
+         }
+      }
+#endif
+
+#if defined( MICRO_TEST_POSIX ) && defined( MICRO_TEST_FUZZ )
+      //==================
+      // Fuzz Test Helper
+      //==================
+
+      // Test i_fn( data, size ) survives mutated inputs for i_seconds. The
+      // fuzz loop runs in one child process, guided by edge coverage when the
+      // code is built with -fsanitize-coverage (blind mutation otherwise).
+      // Files in i_corpus seed the run and inputs reaching new coverage are
+      // added to it. A crashing input is minimized, and saved to i_corpus as
+      // crash-<hash>.
+      void fuzz( const fuzz_lambda_t i_fn, const double i_seconds, const std::string & i_corpus = "" )
+      {
+         Fixture fix( this );
+         void * const memory = mmap( nullptr, sizeof( FuzzShared_t ), PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_ANON, -1, 0 );
+
+         if ( memory == MAP_FAILED )
+         {
+            test_note = "Fuzz: can't map shared memory";
+            test_status_fail();
+            return;
+         }
+
+         FuzzShared_t & shared = *static_cast<FuzzShared_t *>( memory );
+
+         if ( !i_corpus.empty() )
+         {
+            mkdir( i_corpus.c_str(), 0755 );
+         }
+
+         const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+         const ChildResult_t child = run_in_child( [&]
+         {
+            // Quiet the target, a crash is reported from the shared input.
+            const int null = open( "/dev/null", O_WRONLY );
+            dup2( null, STDOUT_FILENO );
+            dup2( null, STDERR_FILENO );
+            alarm( static_cast<unsigned>( i_seconds ) + 10 );
+
+            fuzz_loop( i_fn, i_seconds, i_corpus, shared );
+         }, i_seconds + 15 );
+         const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+         std::ostringstream note;
+         note << "Fuzz: " << shared.execs << " inputs in "
+              << std::floor( seconds * 10 + 0.5 ) / 10 << "s (" << static_cast<uint64_t>( shared.execs / seconds ) << " execs/s), ";
+
+         if ( shared.edges )
+         {
+            note << shared.edges << " edges, corpus " << shared.corpus;
+         }
+         else
+         {
+            note << "blind mutation, no coverage instrumentation";
+         }
+
+         if ( shared.done && child.exited && child.status == 0 )
+         {
+            munmap( memory, sizeof( FuzzShared_t ) );
+            test_note = note.str();
+            test_status_pass();
+            return;
+         }
+
+         std::vector<uint8_t> input( shared.data, shared.data + ( shared.done ? 0 : shared.size ) );
+         munmap( memory, sizeof( FuzzShared_t ) );
+
+         ChildResult_t crash = child;
+
+         // A hang would take 10s per try to minimize.
+         if ( !child.timed_out && ( child.exited || child.status != SIGALRM ) )
+         {
+            crash = fuzz_minimize( i_fn, input, child );
+         }
+
+         note << "\n      crash:  ";
+
+         if ( crash.threw )
+         {
+            note << "uncaught exception";
+         }
+         else if ( crash.exited )
+         {
+            note << "exit code " << crash.status;
+         }
+         else if ( crash.timed_out || crash.status == SIGALRM )
+         {
+            note << "timeout";
+         }
+         else
+         {
+            note << "signal " << crash.status << " (" << strsignal( crash.status ) << ")";
+         }
+
+         note << ", input " << input.size() << " bytes \"";
+
+         for ( std::size_t i = 0; i < input.size() && i < 64; ++i )
+         {
+            const uint8_t c = input[i];
+
+            if ( c >= ' ' && c < 127 && c != '"' && c != '\\' )
+            {
+               note << static_cast<char>( c );
+            }
+            else
+            {
+               static const char hex[] = "0123456789abcdef";
+               note << "\\x" << hex[c >> 4] << hex[c & 15];
+            }
+         }
+
+         note << ( input.size() > 64 ? "\"..." : "\"" );
+
+         const std::size_t line = crash.err.find( '\n' );
+
+         if ( !crash.err.empty() )
+         {
+            note << "\n      stderr: " << crash.err.substr( 0, line );
+         }
+
+         if ( !i_corpus.empty() )
+         {
+            note << "\n      saved:  "
+                 << fuzz_save( i_corpus, "crash-", input.empty() ? nullptr : &input[0], input.size() );
+         }
+
+         test_note = note.str();
+         test_status_fail();
+      }
+#endif
+   };
+
+} // namespace MicroTest
+
+#ifdef MICRO_TEST_LEAK_CHECK
+// Allocation functions recording heap blocks for the leak checker. Define
+// MICRO_TEST_LEAK_CHECK before including Micro Test in one source file.
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <new>
+
+// The allocation functions find their caller's return address.
+#if defined( __GNUC__ )
+#define MICRO_TEST_NOINLINE __attribute__(( noinline ))
+#define MICRO_TEST_CALLER __builtin_return_address( 0 )
+#elif defined( _MSC_VER )
+#include <intrin.h>
+#define MICRO_TEST_NOINLINE __declspec( noinline )
+#define MICRO_TEST_CALLER _ReturnAddress()
+#else
+#error "MICRO_TEST_LEAK_CHECK needs GCC, Clang or MSVC"
+#endif
+
+namespace MicroTest
+{
+   // Stack of an allocation from the caller of operator new at i_site, in
+   // the stack table. Only the return address is kept without backtrace.
+   inline uint32_t leak_stack( void * const i_site ) noexcept
+   {
+#ifdef MICRO_TEST_BACKTRACE
+      // Room for the frames of the allocation functions before i_site.
+      void * frames[Leaks::DEPTH + 3];
+      const Leaks::Pause pause;
+      const int depth = backtrace( frames, Leaks::DEPTH + 3 );
+      int first = 0;
+
+      while ( first < depth && frames[first] != i_site )
+      {
+         ++first;
+      }
+
+      if ( first == depth )
+      {
+         first = 0;
+      }
+
+      return Leaks::intern( frames + first, std::min( depth - first, static_cast<int>( Leaks::DEPTH ) ) );
+#else
+      void * const frames[1] = { i_site };
+      return Leaks::intern( frames, 1 );
+#endif
+   }
+
+   inline void * leak_allocate( const std::size_t i_size, void * const i_site ) noexcept
+   {
+      void * const block = std::malloc( i_size ? i_size : 1 );
+
+      if ( block && Leaks::tracking() )
+      {
+         Leaks::add( block, i_size, leak_stack( i_site ) );
+      }
+
+      return block;
+   }
+
+#ifdef MICRO_TEST_BACKTRACE
+   // Function name of a frame without its parameters and return type.
+   inline std::string leak_frame( void * const i_address )
+   {
+      std::string name = frame_name( i_address );
+      const std::size_t close = name.rfind( ')' );
+
+      if ( close != std::string::npos )
+      {
+         int depth = 0;
+
+         for ( std::size_t i = close + 1; i-- > 0; )
+         {
+            depth += name[i] == ')' ? 1 : name[i] == '(' ? -1 : 0;
+
+            if ( depth == 0 )
+            {
+               name.erase( i );
+               break;
+            }
+         }
+      }
+
+      int depth = 0;
+
+      for ( std::size_t i = name.size(); i-- > 0; )
+      {
+         const char c = name[i];
+         depth += c == '>' || c == ')' ? 1 : c == '<' || c == '(' ? -1 : 0;
+
+         if ( c == ' ' && depth == 0 && ( i < 8 || name.compare( i - 8, 8, "operator" ) != 0 ) )
+         {
+            name.erase( 0, i + 1 );
+            break;
+         }
+      }
+
+      return name;
+   }
+#endif
+
+   // Allocation stack i_stack, up to 4 functions from the first outside the
+   // standard library, joined by " < ".
+   inline std::string leak_stack_text( const uint32_t i_stack )
+   {
+      Leaks::Stack_t * const stacks = Leaks::stacks();
+
+      if ( !stacks || !i_stack )
+      {
+         return "an unknown site";
+      }
+
+      const Leaks::Stack_t & stack = stacks[i_stack - 1];
+      const int depth = stack.depth.load( std::memory_order_acquire );
+      std::ostringstream text;
+      int shown = 0;
+
+      for ( int i = 0; i < depth && shown < 4; ++i )
+      {
+#ifdef MICRO_TEST_BACKTRACE
+         const std::string name = leak_frame( stack.frames[i] );
+         const bool internal = name.compare( 0, 5, "std::" ) == 0 || name.compare( 0, 11, "__gnu_cxx::" ) == 0 ||
+                               name.compare( 0, 11, "MicroTest::" ) == 0 || name.compare( 0, 8, "operator" ) == 0;
+
+         // Frames of the allocator, unless every frame is.
+         if ( internal && !shown && i + 1 < depth )
+         {
+            continue;
+         }
+
+         // The C library calling main.
+         if ( shown && ( name.compare( 0, 7, "__libc_" ) == 0 || name.find( "libc.so" ) != std::string::npos ) )
+         {
+            break;
+         }
+
+         text << ( shown++ ? " < " : "" ) << name;
+#else
+         text << ( shown++ ? " < " : "" ) << stack.frames[i];
+#endif
+      }
+
+      return text.str();
+   }
+
+   // Note on the blocks test i_test left allocated, grouped by allocation
+   // stack, or empty when it left none. The blocks are taken out of the
+   // table, a leak is reported once. Made here so the reporting code is
+   // only compiled into the program once.
+   inline std::string leak_report( const uint32_t i_test )
+   {
+      Leaks::Slot_t * const slots = Leaks::table();
+
+      if ( !slots )
+      {
+         return "";
+      }
+
+      // Blocks and bytes by allocation stack.
+      std::map<uint32_t, std::pair<std::size_t, std::size_t>> stacks;
+      std::size_t blocks = 0;
+      std::size_t bytes = 0;
+
+      for ( std::size_t i = 0; i < Leaks::SLOTS; ++i )
+      {
+         if ( slots[i].key.load( std::memory_order_acquire ) > Leaks::BUSY &&
+               slots[i].test.load( std::memory_order_relaxed ) == i_test )
+         {
+            const std::size_t size = slots[i].size.load( std::memory_order_relaxed );
+            std::pair<std::size_t, std::size_t> & stack = stacks[slots[i].stack.load( std::memory_order_relaxed )];
+            ++stack.first;
+            stack.second += size;
+            ++blocks;
+            bytes += size;
+            Leaks::forget( slots[i] );
+         }
+      }
+
+      if ( !blocks )
+      {
+         return "";
+      }
+
+      // Stacks differing only in frames not shown are reported together.
+      std::map<std::string, std::pair<std::size_t, std::size_t>> sites;
+
+      for ( std::map<uint32_t, std::pair<std::size_t, std::size_t>>::const_iterator it = stacks.begin();
+            it != stacks.end(); ++it )
+      {
+         std::pair<std::size_t, std::size_t> & site = sites[leak_stack_text( it->first )];
+         site.first += it->second.first;
+         site.second += it->second.second;
+      }
+
+      std::vector<std::pair<std::size_t, std::string>> largest;
+
+      for ( std::map<std::string, std::pair<std::size_t, std::size_t>>::const_iterator it = sites.begin();
+            it != sites.end(); ++it )
+      {
+         largest.push_back( std::make_pair( it->second.second, it->first ) );
+      }
+
+      std::sort( largest.rbegin(), largest.rend() );
+
+      std::ostringstream note;
+      note << "Leak: " << blocks << ( blocks == 1 ? " block, " : " blocks, " ) << bytes
+           << " bytes still allocated after the test";
+
+      for ( std::size_t i = 0; i < largest.size() && i < 5; ++i )
+      {
+         const std::size_t count = sites[largest[i].second].first;
+         note << "\n      " << count << ( count == 1 ? " block, " : " blocks, " )
+              << largest[i].first << " bytes from " << largest[i].second;
+      }
+
+      return note.str();
+   }
+
+   inline bool leak_install()
+   {
+#ifdef MICRO_TEST_BACKTRACE
+      // The first backtrace loads the unwinder, not while in operator new.
+      void * frame;
+      backtrace( &frame, 1 );
+#endif
+      Leaks::state().report = &leak_report;
+      Leaks::state().installed = true;
+      return true;
+   }
+
+   static const bool leak_check_installed = leak_install();
+} // namespace MicroTest
+
+// The blocks are from malloc in leak_allocate.
+#if defined( __GNUC__ ) && !defined( __clang__ ) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Not inlined, the return address is the caller's.
+MICRO_TEST_NOINLINE void * operator new( std::size_t i_size )
+{
+   void * const block = MicroTest::leak_allocate( i_size, MICRO_TEST_CALLER );
+
+   if ( !block )
+   {
+      throw std::bad_alloc();
+   }
+
+   return block;
+}
+MICRO_TEST_NOINLINE void * operator new[]( std::size_t i_size )
+{
+   void * const block = MicroTest::leak_allocate( i_size, MICRO_TEST_CALLER );
+
+   if ( !block )
+   {
+      throw std::bad_alloc();
+   }
+
+   return block;
+}
+MICRO_TEST_NOINLINE void * operator new( std::size_t i_size, const std::nothrow_t & ) noexcept
+{
+   return MicroTest::leak_allocate( i_size, MICRO_TEST_CALLER );
+}
+MICRO_TEST_NOINLINE void * operator new[]( std::size_t i_size, const std::nothrow_t & ) noexcept
+{
+   return MicroTest::leak_allocate( i_size, MICRO_TEST_CALLER );
+}
+
+void operator delete( void * i_block ) noexcept
+{
+   MicroTest::Leaks::remove( i_block );
+   std::free( i_block );
+}
+void operator delete[]( void * i_block ) noexcept
+{
+   MicroTest::Leaks::remove( i_block );
+   std::free( i_block );
+}
+void operator delete( void * i_block, const std::nothrow_t & ) noexcept
+{
+   MicroTest::Leaks::remove( i_block );
+   std::free( i_block );
+}
+void operator delete[]( void * i_block, const std::nothrow_t & ) noexcept
+{
+   MicroTest::Leaks::remove( i_block );
+   std::free( i_block );
+}
+#if __cplusplus >= 201402L
+void operator delete( void * i_block, std::size_t ) noexcept
+{
+   MicroTest::Leaks::remove( i_block );
+   std::free( i_block );
+}
+void operator delete[]( void * i_block, std::size_t ) noexcept
+{
+   MicroTest::Leaks::remove( i_block );
+   std::free( i_block );
+}
+#endif
+
+#if defined( __GNUC__ ) && !defined( __clang__ ) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#endif // MICRO_TEST_LEAK_CHECK
 
 #endif // _micro_test_hpp_
 
@@ -21,6 +21,8 @@
 #include <sstream>
 #include <functional>
 
+// Death tests, dies and exits.
+#define MICRO_TEST_DEATH
 #include "micro-test.hpp"
 
 class TestException
@@ -145,6 +147,14 @@ int main( int argc, char * argv[] )
          //throw("BOOM!");
       } );
    }
+   test = "Calling abort terminates the program";
+   {
+      // Runs in a child process, the test program keeps going.
+      test.dies( []
+      {
+         std::abort();
+      } );
+   }
    return 0;
 }
 
@@ -0,0 +1,497 @@
+/**
+ * @file:  run.main.cpp
+ * @brief: Micro Test parallel test driver.
+ *
+ * @description
+ * Finds Micro Test programs, runs them in parallel and merges their
+ * test summaries into one report and exit code.
+ *
+ * License: GNU Public License (GNU GPL)
+ * Copyright (c) 2016 Rajinder Yadav <devguy.ca@gmail.com>
+ *
+ * Notice: This Software is provided as-is without warrant.
+ */
+
+// Usage: micro_test_run [OPTIONS] [PATH...] [-- TEST ARGUMENTS]
+//
+// Each PATH is a test program or a directory searched recursively for test
+// programs, executables named *_test, *_tests, *_tester or *_check (or
+// containing the --match text). The default PATH is the current directory.
+// Symbolic links to directories are followed once, and the driver itself is
+// never run.
+//
+// Programs are started slowest first, using run times saved from earlier
+// runs in the history file, and no new program is started while the load
+// average is above the number of CPUs. Output of each program is captured
+// and printed when it fails (or always with -v). The "Test Summary" line of
+// each program is parsed and the totals reported, the exit code is 1 when
+// any test failed or any program failed to produce a summary.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <iomanip>
+
+#include "micro-test.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+   struct Program
+   {
+      std::string path;
+      double history;    // Seconds taken last time, negative when unknown.
+
+      pid_t pid;
+      int fd;
+      std::string output;
+      std::chrono::steady_clock::time_point start;
+   };
+
+   // Device and inode of a file, identifies it whatever path leads to it.
+   typedef std::pair<dev_t, ino_t> FileId;
+
+   struct Options
+   {
+      FileId self;       // This driver, never run as a test program.
+      unsigned jobs;
+      bool verbose;
+      std::string match;
+      std::string history;
+      std::vector<std::string> paths;
+      std::vector<std::string> arguments;
+   };
+
+   bool EndsWith( const std::string & i_text, const std::string & i_end )
+   {
+      return i_text.size() >= i_end.size() &&
+             i_text.compare( i_text.size() - i_end.size(), i_end.size(), i_end ) == 0;
+   }
+
+   bool IsTestName( const std::string & i_name, const Options & i_options )
+   {
+      if ( !i_options.match.empty() )
+      {
+         return i_name.find( i_options.match ) != std::string::npos;
+      }
+
+      return EndsWith( i_name, "_test" ) || EndsWith( i_name, "_tests" ) ||
+             EndsWith( i_name, "_tester" ) || EndsWith( i_name, "_check" );
+   }
+
+   bool IsExecutable( const std::string & i_path )
+   {
+      struct stat info;
+      return stat( i_path.c_str(), &info ) == 0 && S_ISREG( info.st_mode ) &&
+             access( i_path.c_str(), X_OK ) == 0;
+   }
+
+   // Directories are followed through symbolic links, each one only once so
+   // a link back up the tree doesn't recurse forever.
+   void Discover( const std::string & i_path, const Options & i_options,
+                  std::set<FileId> & io_visited, std::vector<std::string> & o_found )
+   {
+      struct stat info;
+
+      if ( stat( i_path.c_str(), &info ) != 0 )
+      {
+         std::cerr << "micro_test_run: can't find " << i_path << std::endl;
+         return;
+      }
+
+      if ( !S_ISDIR( info.st_mode ) )
+      {
+         if ( FileId( info.st_dev, info.st_ino ) != i_options.self && IsExecutable( i_path ) )
+         {
+            o_found.push_back( i_path );
+         }
+
+         return;
+      }
+
+      if ( !io_visited.insert( FileId( info.st_dev, info.st_ino ) ).second )
+      {
+         return;
+      }
+
+      DIR * dir = opendir( i_path.c_str() );
+
+      if ( !dir )
+      {
+         return;
+      }
+
+      while ( struct dirent * entry = readdir( dir ) )
+      {
+         const std::string name( entry->d_name );
+
+         // Skip hidden entries and CMake's own scratch programs.
+         if ( name[0] == '.' || name == "CMakeFiles" )
+         {
+            continue;
+         }
+
+         const std::string path = i_path + "/" + name;
+
+         if ( stat( path.c_str(), &info ) != 0 )
+         {
+            continue;
+         }
+
+         if ( S_ISDIR( info.st_mode ) )
+         {
+            Discover( path, i_options, io_visited, o_found );
+         }
+         else if ( FileId( info.st_dev, info.st_ino ) != i_options.self &&
+                   IsTestName( name, i_options ) && IsExecutable( path ) )
+         {
+            o_found.push_back( path );
+         }
+      }
+
+      closedir( dir );
+   }
+
+   std::map<std::string, double> LoadHistory( const std::string & i_file )
+   {
+      std::map<std::string, double> history;
+      std::ifstream in( i_file.c_str() );
+      double seconds;
+      std::string path;
+
+      while ( in >> seconds && std::getline( in >> std::ws, path ) )
+      {
+         history[path] = seconds;
+      }
+
+      return history;
+   }
+
+   double LoadAverage()
+   {
+      std::ifstream in( "/proc/loadavg" );
+      double load = 0;
+      in >> load;
+      return load;
+   }
+
+   bool Start( Program & io_program, const Options & i_options )
+   {
+      int fd[2];
+
+      if ( pipe( fd ) != 0 )
+      {
+         return false;
+      }
+
+      io_program.start = std::chrono::steady_clock::now();
+      io_program.pid = fork();
+
+      if ( io_program.pid == 0 )
+      {
+         close( fd[0] );
+         dup2( fd[1], STDOUT_FILENO );
+         dup2( fd[1], STDERR_FILENO );
+         close( fd[1] );
+
+         std::vector<char *> argv;
+         argv.push_back( const_cast<char *>( io_program.path.c_str() ) );
+
+         for ( std::size_t i = 0; i < i_options.arguments.size(); ++i )
+         {
+            argv.push_back( const_cast<char *>( i_options.arguments[i].c_str() ) );
+         }
+
+         argv.push_back( nullptr );
+         execv( io_program.path.c_str(), &argv[0] );
+         std::perror( io_program.path.c_str() );
+         _exit( 127 );
+      }
+
+      close( fd[1] );
+
+      if ( io_program.pid < 0 )
+      {
+         close( fd[0] );
+         return false;
+      }
+
+      io_program.fd = fd[0];
+      return true;
+   }
+
+   void Usage( const char * const i_program )
+   {
+      std::cout << "\nMicro Test Run Usage\n"
+                << "====================\n\n"
+                << i_program << " [OPTIONS] [PATH...] [-- TEST ARGUMENTS]\n\n"
+                << "OPTIONS\n"
+                << "   -j n           Programs to run at the same time (default CPUs).\n"
+                << "   -v             Show the output of every program.\n"
+                << "   --match=text   Run programs with text in their name, instead of\n"
+                << "                  *_test, *_tests, *_tester and *_check.\n"
+                << "   --history=file Run times from earlier runs\n"
+                << "                  (default .micro_test_run.history).\n"
+                << "   -h             Output this usage message and exit.\n\n";
+      std::exit( 1 );
+   }
+}
+
+int main( int argc, char * argv[] )
+{
+   Options options;
+   options.jobs = std::thread::hardware_concurrency();
+   options.verbose = false;
+   options.history = ".micro_test_run.history";
+
+   // The driver may itself match --match or sit in a searched directory.
+   struct stat self;
+
+   if ( stat( "/proc/self/exe", &self ) == 0 || stat( argv[0], &self ) == 0 )
+   {
+      options.self = FileId( self.st_dev, self.st_ino );
+   }
+
+   for ( int i = 1; i < argc; ++i )
+   {
+      const std::string arg( argv[i] );
+
+      if ( arg == "--" )
+      {
+         options.arguments.assign( argv + i + 1, argv + argc );
+         break;
+      }
+      else if ( arg == "-j" && i + 1 < argc )
+      {
+         options.jobs = static_cast<unsigned>( std::atoi( argv[++i] ) );
+      }
+      else if ( arg == "-v" )
+      {
+         options.verbose = true;
+      }
+      else if ( arg.compare( 0, 8, "--match=" ) == 0 )
+      {
+         options.match = arg.substr( 8 );
+      }
+      else if ( arg.compare( 0, 10, "--history=" ) == 0 )
+      {
+         options.history = arg.substr( 10 );
+      }
+      else if ( arg[0] == '-' )
+      {
+         Usage( argv[0] );
+      }
+      else
+      {
+         options.paths.push_back( arg );
+      }
+   }
+
+   if ( options.jobs == 0 )
+   {
+      options.jobs = 1;
+   }
+
+   if ( options.paths.empty() )
+   {
+      options.paths.push_back( "." );
+   }
+
+   std::vector<std::string> found;
+   std::set<FileId> visited;
+
+   for ( std::size_t i = 0; i < options.paths.size(); ++i )
+   {
+      Discover( options.paths[i], options, visited, found );
+   }
+
+   std::sort( found.begin(), found.end() );
+   found.erase( std::unique( found.begin(), found.end() ), found.end() );
+
+   // Slowest first so the longest program doesn't start last, programs
+   // never seen before are assumed slow.
+   std::map<std::string, double> history = LoadHistory( options.history );
+   std::vector<Program> programs;
+
+   for ( std::size_t i = 0; i < found.size(); ++i )
+   {
+      Program program;
+      program.path = found[i];
+      program.history = history.count( found[i] ) ? history[found[i]] : -1;
+      program.pid = -1;
+      program.fd = -1;
+      programs.push_back( program );
+   }
+
+   std::stable_sort( programs.begin(), programs.end(), []( const Program & a, const Program & b )
+   {
+      return ( a.history < 0 ? 1e30 : a.history ) > ( b.history < 0 ? 1e30 : b.history );
+   } );
+
+   std::cout << "Micro Test Run v" << MicroTest::VERSION << ", " << programs.size()
+             << " test programs, " << options.jobs << " at a time.\n" << std::endl;
+
+   const long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+   std::vector<Program *> running;
+   std::size_t next = 0;
+   unsigned long long tests = 0;
+   unsigned long long passed = 0;
+   unsigned long long failed = 0;
+   unsigned broken = 0;
+
+   while ( next < programs.size() || !running.empty() )
+   {
+      // Hold back new programs while the machine is overloaded.
+      while ( next < programs.size() && running.size() < options.jobs &&
+              ( running.empty() || LoadAverage() < cpus ) )
+      {
+         Program & program = programs[next++];
+
+         if ( Start( program, options ) )
+         {
+            running.push_back( &program );
+         }
+         else
+         {
+            std::cout << MicroTest::FAIL << "can't start " << program.path
+                      << MicroTest::WHITE << std::endl;
+            ++broken;
+         }
+      }
+
+      std::vector<struct pollfd> ready( running.size() );
+
+      for ( std::size_t i = 0; i < running.size(); ++i )
+      {
+         ready[i].fd = running[i]->fd;
+         ready[i].events = POLLIN;
+         ready[i].revents = 0;
+      }
+
+      if ( !ready.empty() && poll( &ready[0], ready.size(), 200 ) < 0 && errno != EINTR )
+      {
+         break;
+      }
+
+      for ( std::size_t i = running.size(); i-- > 0; )
+      {
+         if ( !ready[i].revents )
+         {
+            continue;
+         }
+
+         Program & program = *running[i];
+         char buffer[4096];
+         const ssize_t n = read( program.fd, buffer, sizeof buffer );
+
+         if ( n > 0 )
+         {
+            program.output.append( buffer, static_cast<std::size_t>( n ) );
+            continue;
+         }
+
+         if ( n < 0 && errno == EINTR )
+         {
+            continue;
+         }
+
+         close( program.fd );
+
+         int status = 0;
+
+         while ( waitpid( program.pid, &status, 0 ) < 0 && errno == EINTR )
+         {
+         }
+
+         const double seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - program.start ).count();
+         history[program.path] = seconds;
+
+         // Last summary line in the output.
+         unsigned long long t = 0;
+         unsigned long long p = 0;
+         unsigned long long f = 0;
+         const std::size_t summary = program.output.rfind( "Test Summary: Tests(" );
+         const bool parsed = summary != std::string::npos &&
+                             std::sscanf( program.output.c_str() + summary,
+                                          "Test Summary: Tests(%llu) Passed(%llu) Failed(%llu)",
+                                          &t, &p, &f ) == 3;
+
+         const bool exited = WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+         const bool ok = parsed && exited && f == 0;
+
+         if ( parsed )
+         {
+            tests += t;
+            passed += p;
+            failed += f;
+         }
+
+         if ( !parsed || !exited )
+         {
+            ++broken;
+         }
+
+         if ( options.verbose || !ok )
+         {
+            std::cout << program.output << std::endl;
+         }
+
+         std::cout << ( ok ? MicroTest::PASS : MicroTest::FAIL ) << program.path
+                   << MicroTest::WHITE << " Tests(" << t << ") Passed(" << p
+                   << ") Failed(" << f << ") " << std::fixed << std::setprecision( 2 )
+                   << seconds << "s";
+
+         if ( !parsed )
+         {
+            std::cout << ", no test summary";
+         }
+
+         if ( WIFSIGNALED( status ) )
+         {
+            std::cout << ", killed by signal " << WTERMSIG( status );
+         }
+         else if ( WIFEXITED( status ) && WEXITSTATUS( status ) != 0 )
+         {
+            std::cout << ", exit code " << WEXITSTATUS( status );
+         }
+
+         std::cout << std::endl;
+         running.erase( running.begin() + i );
+      }
+   }
+
+   std::ofstream out( options.history.c_str() );
+
+   for ( std::map<std::string, double>::const_iterator it = history.begin(); it != history.end(); ++it )
+   {
+      out << it->second << ' ' << it->first << '\n';
+   }
+
+   std::cout << "==============================================\n"
+             << "Combined Summary: Programs(" << programs.size() << ") "
+             << "Tests(" << tests << ") "
+             << "Passed(" << passed << ") "
+             << "Failed(" << failed << ") "
+             << "Broken(" << broken << ")\n" << std::endl;
+
+   return failed || broken ? 1 : 0;
+}
@@ -35,13 +35,25 @@
 //
 // MICRO TEST VERIFICATION SUCCESSFULL.
 //
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <fstream>
 #include <sstream>
 #include <functional>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <vector>
 
+#include <unistd.h>
+
+// Every opt-in helper, and the fuzz helper with its coverage callbacks.
+#define MICRO_TEST_ALL
+#define MICRO_TEST_FUZZ
 #include "micro-test.hpp"
 
 class Person
@@ -65,6 +77,21 @@ int main( int argc, char * argv[] )
 {
    MicroTest::TestRunner test( argc, argv );
 
+   // Data files of the table driven tests, in a directory of their own.
+   const char * const tmp = std::getenv( "TMPDIR" );
+   std::string dir = std::string( tmp && *tmp ? tmp : "/tmp" ) + "/health-check.XXXXXX";
+
+   if ( !mkdtemp( &dir[0] ) )
+   {
+      clog << "Error! Can't make a directory for the data files" << std::endl;
+      return 1;
+   }
+
+   const std::string sums = dir + "/sums.csv";
+   const std::string bad_sums = dir + "/bad-sums.csv";
+   const std::string quoted = dir + "/quoted.csv";
+   const std::string ints = dir + "/ints.bin";
+
    Person * p1;
    Person * p2;
    Person * p3;
@@ -524,6 +551,539 @@ int main( int argc, char * argv[] )
       test.should_fail();
    }
 
+   //=========================
+   // Test Result Table
+   //=========================
+   test = "Result table records each check";
+   {
+      const MicroTest::ResultTable & results = test.result_table();
+      const std::size_t rows = results.size();
+      test.eq( 1, 1 );
+      test.all( results.size() == rows + 1,
+                results.passed( rows ),
+                results.description( rows ) == "Result table records each check" );
+      test.should_pass();
+   }
+   test = "Result table records each check";
+   {
+      const MicroTest::ResultTable & results = test.result_table();
+      const std::size_t rows = results.size();
+      test.eq( 1, 2 );
+      test.f( results.passed( rows ) );
+      test.should_pass();
+   }
+
+   //=========================
+   // Test Property
+   //=========================
+   test = "Integer division and remainder rebuild the dividend";
+   {
+      test.property( MicroTest::Gen::integer( -1000, 1000 ),
+                     MicroTest::Gen::integer( -1000, 1000 ),
+                     []( int a, int b )
+      {
+         return b == 0 || ( a / b ) * b + a % b == a;
+      }, 10000 );
+      test.should_pass();
+   }
+   test = "Integers are below 100";
+   {
+      test.property( MicroTest::Gen::integer( 0, 1000 ), []( int a )
+      {
+         return a < 100;
+      }, 1000 );
+      test.should_fail();
+   }
+   test = "Reversing a string twice gives the string";
+   {
+      test.property( MicroTest::Gen::string(), []( const std::string & s )
+      {
+         const std::string reversed( s.rbegin(), s.rend() );
+         return std::string( reversed.rbegin(), reversed.rend() ) == s;
+      }, 1000 );
+      test.should_pass();
+   }
+   test = "Vectors are sorted";
+   {
+      test.property( MicroTest::Gen::vector( MicroTest::Gen::real( 0.0, 1.0 ) ),
+                     []( const std::vector<double> & v )
+      {
+         return std::is_sorted( v.begin(), v.end() );
+      }, 1000 );
+      test.should_fail();
+   }
+
+   //=========================
+   // Test Differential
+   //=========================
+   test = "Shift matches multiply by 2";
+   {
+      test.differential( []( MicroTest::Random & rng )
+      {
+         return static_cast<int>( rng() % 100000 );
+      },
+      []( const int x )
+      {
+         return x * 2;
+      },
+      []( const int x )
+      {
+         return x << 1;
+      }, 100000 );
+      test.should_pass();
+   }
+   test = "Shift matches multiply by 2";
+   {
+      test.differential( []( MicroTest::Random & rng )
+      {
+         return static_cast<int>( rng() % 1000 );
+      },
+      []( const int x )
+      {
+         return x * 2;
+      },
+      []( const int x )
+      {
+         return x == 777 ? 0 : x << 1;
+      }, 100000 );
+      test.should_fail();
+   }
+   test = "Float sum matches double sum within tolerance";
+   {
+      test.differential( []( MicroTest::Random & rng )
+      {
+         return std::uniform_real_distribution<double>( 0, 1 )( rng );
+      },
+      []( const double x )
+      {
+         return x + x;
+      },
+      []( const double x )
+      {
+         return static_cast<double>( static_cast<float>( x ) + static_cast<float>( x ) );
+      }, 10000,
+      []( const double a, const double b )
+      {
+         return a - b < 1e-6 && b - a < 1e-6;
+      } );
+      test.should_pass();
+   }
+   test = "Float sum matches double sum exactly";
+   {
+      test.differential( []( MicroTest::Random & rng )
+      {
+         return std::uniform_real_distribution<double>( 0, 1 )( rng );
+      },
+      []( const double x )
+      {
+         return x + x;
+      },
+      []( const double x )
+      {
+         return static_cast<double>( static_cast<float>( x ) + static_cast<float>( x ) );
+      }, 10000 );
+      test.should_fail();
+   }
+   test = "Candidate throws on some inputs";
+   {
+      test.differential( []( MicroTest::Random & rng )
+      {
+         return static_cast<int>( rng() % 1000 );
+      },
+      []( const int x )
+      {
+         return x * 2;
+      },
+      []( const int x )
+      {
+         if ( x == 500 )
+         {
+            throw std::runtime_error( "no 500" );
+         }
+
+         return x << 1;
+      }, 100000 );
+      test.should_fail();
+   }
+   test = "Lowest input that differs is reported, a throw or a wrong value";
+   {
+      const MicroTest::ResultTable & results = test.result_table();
+      const std::size_t row = results.size();
+      test.differential( []( MicroTest::Random & rng )
+      {
+         return static_cast<int>( rng() % 1000 );
+      },
+      []( const int x )
+      {
+         return x * 2;
+      },
+      []( const int x )
+      {
+         if ( x == 500 )
+         {
+            throw std::runtime_error( "no 500" );
+         }
+
+         return x == 777 ? 0 : x << 1;
+      }, 100000 );
+
+      // Every input below the one reported is neither 500 nor 777.
+      std::size_t input = 0;
+      unsigned long long seed = 0;
+      const bool found = std::sscanf( results.note( row ).c_str(), "Differential: input %zu (seed %llu)",
+                                      &input, &seed ) == 2;
+      bool lowest = found;
+
+      for ( std::size_t i = 0; lowest && i <= input; ++i )
+      {
+         MicroTest::Random rng = MicroTest::Random::stream( seed, i );
+         const int x = static_cast<int>( rng() % 1000 );
+         lowest = ( x == 500 || x == 777 ) == ( i == input );
+      }
+
+      test( lowest );
+      test.should_pass();
+   }
+
+   //=========================
+   // Test Complexity
+   //=========================
+   // Up to 16 KB of ints, within the L1 cache.
+   test = "Summing a vector is O(n)";
+   {
+      std::vector<int> v;
+      volatile long long sink = 0;
+      test.complexity( [&]( std::size_t n )
+      {
+         v.assign( n, 1 );
+      },
+      [&]
+      {
+         long long sum = 0;
+
+         for ( std::size_t i = 0; i < v.size(); ++i )
+         {
+            sum += v[i];
+         }
+
+         sink = sum;
+      }, MicroTest::TestRunner::geometric_sizes( 256, 4096 ),
+      MicroTest::TestRunner::O_N );
+      test.should_pass();
+   }
+   test = "Summing a vector is O(log n)";
+   {
+      std::vector<int> v;
+      volatile long long sink = 0;
+      test.complexity( [&]( std::size_t n )
+      {
+         v.assign( n, 1 );
+      },
+      [&]
+      {
+         long long sum = 0;
+
+         for ( std::size_t i = 0; i < v.size(); ++i )
+         {
+            sum += v[i];
+         }
+
+         sink = sum;
+      }, MicroTest::TestRunner::geometric_sizes( 256, 4096 ),
+      MicroTest::TestRunner::O_LOG_N );
+      test.should_fail();
+   }
+
+   //=========================
+   // Test Scaling
+   //=========================
+   test = "Independent counters scale to 4 threads";
+   {
+      const MicroTest::ResultTable & results = test.result_table();
+      const std::size_t row = results.size();
+      std::vector<long long> counters( 4 * 16 );
+      test.scaling( [&]( unsigned t )
+      {
+         ++counters[t * 16];
+      }, 4 );
+      const std::string & note = results.note( row );
+      test( counters[0] > 0 && counters[3 * 16] > 0 );
+      test( note.find( "\n      4, " ) != std::string::npos && note.find( "nan" ) == std::string::npos );
+      test.should_pass();
+   }
+   test = "Independent counters scale at 1000% efficiency";
+   {
+      std::vector<long long> counters( 4 * 16 );
+      test.scaling( [&]( unsigned t )
+      {
+         ++counters[t * 16];
+      }, 4, 10.0 );
+      test.should_fail();
+   }
+   // Wall clock efficiency needs a core for each thread.
+   if ( std::thread::hardware_concurrency() >= 2 )
+   {
+      test = "Independent counters scale at 50% efficiency";
+      {
+         std::vector<long long> counters( 2 * 16 );
+         test.scaling( [&]( unsigned t )
+         {
+            ++counters[t * 16];
+         }, 2, 0.5 );
+         test.should_pass();
+      }
+   }
+   test = "Counter behind one lock scales at 80% efficiency";
+   {
+      std::mutex lock;
+      long long counter = 0;
+      test.scaling( [&]( unsigned )
+      {
+         std::lock_guard<std::mutex> guard( lock );
+         ++counter;
+      }, 2, 0.8 );
+      test.should_fail();
+   }
+   test = "Scaling fails when the function throws";
+   {
+      test.scaling( []( unsigned t )
+      {
+         if ( t == 1 )
+         {
+            throw std::runtime_error( "worker 1 failed" );
+         }
+      }, 2 );
+      test.should_fail();
+   }
+   test = "Scaling on 0 threads";
+   {
+      test.scaling( []( unsigned )
+      {
+      }, 0 );
+      test.should_fail();
+   }
+
+   //=========================
+   // Test Static
+   //=========================
+   // Checked by the compiler, a failing static test stops the build.
+   test = "Static tests";
+   {
+      static_test( "2 + 2 is 4", MicroTest::Static::eq( 2 + 2, 4 ) );
+      static_test( "2 + 2 is not 5", MicroTest::Static::ne( 2 + 2, 5 ) );
+      static_test( "1 is less than 2", MicroTest::Static::lt( 1, 2 ) );
+      static_test( "2 is not less than 1", !MicroTest::Static::lt( 2, 1 ) );
+      static_test( "Ordering", MicroTest::Static::all( MicroTest::Static::le( 1, 1 ),
+                                                       MicroTest::Static::ge( 2, 1 ),
+                                                       MicroTest::Static::gt( 2, 1 ) ) );
+      static_test( "All false", !MicroTest::Static::all( true, false ) );
+      static_test( "C strings", MicroTest::Static::eq( "micro", "micro" ) );
+      static_test( "C strings", MicroTest::Static::ne( "micro", "macro" ) );
+      static_test( "int is 4 bytes or more", sizeof( int ) >= 4 );
+      static_test( "Same type", std::is_same<std::vector<int>::value_type, int>::value );
+      test( true );
+      test.should_pass();
+   }
+
+   //=========================
+   // Test Table Driven
+   //=========================
+   {
+      std::ofstream csv( sums.c_str() );
+      csv << "# a,b,sum\n1,2,3\n10,-4,6\n\n\"2\",\"40\",42\r\n7,7,14\n010,-2,8\n";
+      std::ofstream bad( bad_sums.c_str() );
+      bad << "# a,b,sum\n1,2,3\n10,-4,7\n2,40,42\n5,5\n";
+      std::ofstream open( quoted.c_str() );
+      open << "1,\"one\n2,two\",3\n" << std::string( 40, '1' ) << ",1,2\n12abc,1\n0x1F,1\n010,1\n";
+
+      const int records[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+      std::ofstream bin( ints.c_str(), std::ios::binary );
+      bin.write( reinterpret_cast<const char *>( records ), sizeof records );
+   }
+
+   test = "Rows of CSV file add up";
+   {
+      test.each_row( sums, []( const MicroTest::Row & row )
+      {
+         return row.size() == 3 &&
+                row[0].as_int() + row[1].as_int() == row[2].as_int();
+      } );
+      test.should_pass();
+   }
+   test = "Rows of CSV file add up";
+   {
+      test.each_row( bad_sums, []( const MicroTest::Row & row )
+      {
+         return row[0].as_int() + row[1].as_int() == row[2].as_int();
+      }, true );
+      test.should_fail();
+   }
+   test = "Failing rows are numbered by line in the file";
+   {
+      const MicroTest::ResultTable & results = test.result_table();
+      const std::size_t rows = results.size();
+      test.each_row( bad_sums, []( const MicroTest::Row & row )
+      {
+         return row[0].as_int() + row[1].as_int() == row[2].as_int();
+      }, true );
+      test.eq( results.note( rows ), "Rows: 2 of 4 failed, at 3, 5" );
+      test.should_pass();
+   }
+   test = "Open quotes, long numbers and text fail their rows";
+   {
+      const MicroTest::ResultTable & results = test.result_table();
+      const std::size_t rows = results.size();
+      test.each_row( quoted, []( const MicroTest::Row & row )
+      {
+         return row[0].as_int() >= 0;
+      } );
+      test.eq( results.note( rows ), "Rows: 4 of 6 failed, at 1, 3, 4, 5" );
+      test.should_pass();
+   }
+   test = "Binary records are all positive";
+   {
+      test.each_row<int>( ints, []( const int & value )
+      {
+         return value > 0;
+      }, true );
+      test.should_pass();
+   }
+   test = "Binary records are all even";
+   {
+      test.each_row<int>( ints, []( const int & value )
+      {
+         return value % 2 == 0;
+      } );
+      test.should_fail();
+   }
+   std::remove( sums.c_str() );
+   std::remove( bad_sums.c_str() );
+   std::remove( quoted.c_str() );
+   std::remove( ints.c_str() );
+   rmdir( dir.c_str() );
+
+   //=========================
+   // Test Memory Budget
+   //=========================
+   test = "Vector of 1M ints fits in 64 MB";
+   {
+      std::vector<int> v;
+      test.max_rss( [&]
+      {
+         v.resize( 1000000 );
+      }, 64 * 1024 * 1024 );
+      test.should_pass();
+   }
+   test = "Vector of 1M ints fits in 1 MB";
+   {
+      std::vector<int> v;
+      test.max_rss( [&]
+      {
+         v.resize( 1000000 );
+      }, 1024 * 1024 );
+      test.should_fail();
+   }
+
+   //=========================
+   // Test Death
+   //=========================
+   test = "Process aborts";
+   {
+      test.dies( []
+      {
+         std::abort();
+      } );
+      test.should_pass();
+   }
+   test = "Process aborts";
+   {
+      test.dies( []
+      {
+         // Returns normally.
+      } );
+      test.should_fail();
+   }
+   test = "Process dies with error message";
+   {
+      test.dies( []
+      {
+         std::cerr << "Fatal: out of widgets" << std::endl;
+         std::exit( 2 );
+      }, "out of widgets" );
+      test.should_pass();
+   }
+   test = "Process dies with error message";
+   {
+      test.dies( []
+      {
+         std::cerr << "Fatal: out of gadgets" << std::endl;
+         std::exit( 2 );
+      }, "out of widgets" );
+      test.should_fail();
+   }
+   test = "Process exits with code 3";
+   {
+      test.exits( []
+      {
+         std::exit( 3 );
+      }, 3 );
+      test.should_pass();
+   }
+   test = "Process exits with code 3";
+   {
+      test.exits( []
+      {
+         std::exit( 4 );
+      }, 3 );
+      test.should_fail();
+   }
+   test = "Process dies instead of throwing";
+   {
+      test.dies( []
+      {
+         throw std::runtime_error( "not a crash" );
+      } );
+      test.should_fail();
+   }
+   test = "Hung process is killed after the timeout";
+   {
+      test.dies( []
+      {
+         for ( volatile int spin = 0; ; spin = spin + 1 )
+         {
+         }
+      }, "", 0.2 );
+      test.should_fail();
+   }
+
+   //=========================
+   // Test Fuzz
+   //=========================
+   test = "Fuzzed checksum handles every input";
+   {
+      test.fuzz( []( const uint8_t * data, std::size_t size )
+      {
+         volatile unsigned sum = 0;
+
+         for ( std::size_t i = 0; i < size; ++i )
+         {
+            sum += data[i];
+         }
+      }, 0.2 );
+      test.should_pass();
+   }
+   test = "Fuzzed parser handles every input";
+   {
+      test.fuzz( []( const uint8_t * data, std::size_t size )
+      {
+         if ( size >= 2 && data[0] == 'F' && data[1] == 'Z' )
+         {
+            std::abort();
+         }
+      }, 2 );
+      test.should_fail();
+   }
+
    // This MUST is the last line in the code.
    clog << "\nMICRO TEST VERIFICATION SUCCESSFULL\n\n";
 }
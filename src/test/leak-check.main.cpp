@@ -0,0 +1,151 @@
+/**
+ * @file:  leak-check.main.cpp
+ * @brief: Tests for the MicroTest leak checker.
+ *
+ * @description
+ * Unit Test to validate the MicroTest leak checker. It has a program of its
+ * own, MICRO_TEST_LEAK_CHECK replaces operator new and delete for the whole
+ * program.
+ *
+ * License: GNU Public License (GNU GPL)
+ * Copyright (c) 2016 Rajinder Yadav <devguy.ca@gmail.com>
+ *
+ * Notice: This Software is provided as-is without warrant.
+ */
+
+// LEAK CHECK HEALTH CHECK
+//
+// Each leaking test is followed by a test checking its results in the
+// result table, a leak is found once the next test makes a check.
+//
+// The health check message we should see is:
+//
+// MICRO TEST VERIFICATION SUCCESSFULL.
+//
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <vector>
+
+// Check every test for leaks.
+#define MICRO_TEST_LEAK_CHECK
+#include "micro-test.hpp"
+
+// Allocates a vector for the caller to free, named in the leak notes.
+__attribute__(( noinline )) std::vector<int> * KeepNumbers()
+{
+   return new std::vector<int>( 100 );
+}
+
+int main( int argc, char * argv[] )
+{
+   MicroTest::TestRunner test( argc, argv );
+   const MicroTest::ResultTable & results = test.result_table();
+   std::size_t row = 0;
+   std::vector<int> * kept = nullptr;
+
+   //=========================
+   // Test Leak Check
+   //=========================
+   test = "Test frees what it allocates";
+   {
+      std::vector<int> v( 100 );
+      row = results.size();
+      test( !v.empty() );
+   }
+   test = "No leak reported";
+   {
+      test( true );
+      test( results.passed( row ) );
+      test.should_pass();
+   }
+
+   test = "Test keeps what it allocates";
+   {
+      kept = KeepNumbers();
+      test( !kept->empty() );
+      row = results.size();
+      test( kept->size() == 100 );
+   }
+   test = "Leak fails the last result of the test, no result is added";
+   {
+      test( true );
+      const std::string & note = results.note( row );
+      test( results.passed( row - 1 ) && !results.passed( row ) && results.size() == row + 2 &&
+            note.find( "Leak: 2 blocks" ) == 0 && note.find( "from KeepNumbers < main" ) != std::string::npos );
+      test.should_pass();
+   }
+   delete kept;
+
+   test = "Test without checks keeps what it allocates";
+   {
+      kept = KeepNumbers();
+      row = results.size();
+   }
+   test = "Leak fails a result of its own for a test without checks";
+   {
+      test( true );
+      test( !results.passed( row ) && results.size() == row + 2 &&
+            results.description( row ) == "Test without checks keeps what it allocates" );
+      test.should_pass();
+   }
+   delete kept;
+
+   test = "Description made for test " + std::to_string( 1 );
+   {
+      row = results.size();
+      std::cerr << std::string( 10000, 'x' );
+      test( true );
+   }
+   test = "Description and captured cerr are not leaks";
+   {
+      test( true );
+      test( results.passed( row ) );
+      test.should_pass();
+   }
+
+   std::string * name = nullptr;
+   test.fixture(
+      setup_fixture
+   {
+      name = new std::string( 100, 'x' );
+   },
+   cleanup_fixture
+   {
+      name = nullptr;
+   } );
+   test = "Fixture cleanup frees what setup allocates";
+   {
+      row = results.size();
+      test( name->size() == 100 );
+   }
+   test.fixture();
+   test = "Leak of fixture setup fails the test";
+   {
+      test( true );
+      test( !results.passed( row ) );
+      test.should_pass();
+   }
+
+   test.leaks( false );
+   test = "Test keeps what it allocates, not checked";
+   {
+      kept = KeepNumbers();
+      row = results.size();
+      test( true );
+   }
+   test.leaks( true );
+   test = "No leak reported when checking is off";
+   {
+      test( true );
+      test( results.passed( row ) );
+      test.should_pass();
+   }
+   delete kept;
+
+   // This MUST is the last line in the code.
+   clog << "\nMICRO TEST VERIFICATION SUCCESSFULL\n\n";
+}
@@ -0,0 +1,404 @@
+/**
+ * @file:  report-check.main.cpp
+ * @brief: Tests for the MicroTest report options.
+ *
+ * @description
+ * Unit Test to validate the MicroTest report options. The program runs
+ * itself as a small suite with --stream, --format, --repeat, --profile and
+ * --bench-env and checks the shape of what each one writes.
+ *
+ * License: GNU Public License (GNU GPL)
+ * Copyright (c) 2016 Rajinder Yadav <devguy.ca@gmail.com>
+ *
+ * Notice: This Software is provided as-is without warrant.
+ */
+
+// REPORT OPTIONS HEALTH CHECK
+//
+// Each option is run on a suite selected by REPORT_CHECK_SUITE, with the
+// console output and the report written to files in a directory of their
+// own, followed by the checks of those files.
+//
+// The health check message we should see is:
+//
+// MICRO TEST VERIFICATION SUCCESSFULL.
+//
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MICRO_TEST_REPORTS
+#define MICRO_TEST_TIMING
+#include "micro-test.hpp"
+
+namespace
+{
+   // The suite the options are run on, passing, failing, failing in every
+   // other run, or exiting from a failed should_pass.
+   int Suite( int argc, char * argv[], const std::string & i_kind )
+   {
+      MicroTest::TestRunner test( argc, argv );
+
+      test = "Two checks in one block";
+      {
+         test( true );
+         test( true );
+      }
+
+      if ( i_kind == "report" )
+      {
+         test = "Fails";
+         {
+            test( false );
+         }
+         test = "Slow check";
+         {
+            const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds( 50 );
+            volatile long spins = 0;
+
+            while ( std::chrono::steady_clock::now() < until )
+            {
+               ++spins;
+            }
+
+            test( spins > 0 );
+         }
+      }
+      else if ( i_kind == "fail" )
+      {
+         test = "Fails";
+         {
+            test( false );
+         }
+      }
+      else if ( i_kind == "flaky" )
+      {
+         // Runs are counted in a file, every other run fails.
+         std::ofstream( "runs", std::ios::app ) << '.';
+         std::ifstream runs( "runs" );
+         const std::string count( ( std::istreambuf_iterator<char>( runs ) ), std::istreambuf_iterator<char>() );
+
+         test = "Fails every other run";
+         {
+            test( count.size() % 2 == 0 );
+         }
+      }
+      else if ( i_kind == "exit" )
+      {
+         test = "Exits from should_pass";
+         {
+            test( false );
+            test.should_pass();
+         }
+      }
+
+      return 0;
+   }
+
+   // Run this program as suite i_kind with i_args in i_dir, its console
+   // output going to i_dir/console. Returns the exit status, -1 when it
+   // didn't exit.
+   int Run( const std::string & i_self, const std::string & i_dir, const std::string & i_kind,
+            const std::vector<std::string> & i_args )
+   {
+      clog.flush();
+
+      const pid_t pid = fork();
+
+      if ( pid == 0 )
+      {
+         const std::string console = i_dir + "/console";
+         const int fd = open( console.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600 );
+
+         if ( fd < 0 || chdir( i_dir.c_str() ) != 0 )
+         {
+            _exit( 127 );
+         }
+
+         dup2( fd, STDOUT_FILENO );
+         dup2( fd, STDERR_FILENO );
+         close( fd );
+         setenv( "REPORT_CHECK_SUITE", i_kind.c_str(), 1 );
+
+         std::vector<char *> argv( 1, const_cast<char *>( i_self.c_str() ) );
+
+         for ( std::size_t i = 0; i < i_args.size(); ++i )
+         {
+            argv.push_back( const_cast<char *>( i_args[i].c_str() ) );
+         }
+
+         argv.push_back( nullptr );
+         execv( i_self.c_str(), &argv[0] );
+         _exit( 127 );
+      }
+
+      int status = 0;
+
+      if ( pid < 0 || waitpid( pid, &status, 0 ) != pid )
+      {
+         return -1;
+      }
+
+      return WIFEXITED( status ) ? WEXITSTATUS( status ) : -1;
+   }
+
+   std::vector<std::string> Lines( const std::string & i_path )
+   {
+      std::ifstream in( i_path.c_str() );
+      std::vector<std::string> lines;
+      std::string line;
+
+      while ( std::getline( in, line ) )
+      {
+         lines.push_back( line );
+      }
+
+      return lines;
+   }
+
+   std::string Text( const std::string & i_path )
+   {
+      std::ifstream in( i_path.c_str() );
+      std::ostringstream text;
+      text << in.rdbuf();
+      return text.str();
+   }
+
+   std::size_t Count( const std::string & i_text, const std::string & i_part )
+   {
+      std::size_t count = 0;
+
+      for ( std::size_t at = i_text.find( i_part ); at != std::string::npos; at = i_text.find( i_part, at + 1 ) )
+      {
+         ++count;
+      }
+
+      return count;
+   }
+
+   bool StartsWith( const std::string & i_text, const std::string & i_start )
+   {
+      return i_text.compare( 0, i_start.size(), i_start ) == 0;
+   }
+
+   // Names of the files in i_dir ending with i_suffix.
+   std::vector<std::string> Files( const std::string & i_dir, const std::string & i_suffix )
+   {
+      std::vector<std::string> names;
+      DIR * const dir = opendir( i_dir.c_str() );
+
+      for ( struct dirent * entry = dir ? readdir( dir ) : nullptr; entry; entry = readdir( dir ) )
+      {
+         const std::string name = entry->d_name;
+
+         if ( name.size() > i_suffix.size() &&
+               name.compare( name.size() - i_suffix.size(), i_suffix.size(), i_suffix ) == 0 )
+         {
+            names.push_back( name );
+         }
+      }
+
+      if ( dir )
+      {
+         closedir( dir );
+      }
+
+      return names;
+   }
+}
+
+int main( int argc, char * argv[] )
+{
+   const char * const kind = std::getenv( "REPORT_CHECK_SUITE" );
+
+   if ( kind )
+   {
+      return Suite( argc, argv, kind );
+   }
+
+   MicroTest::TestRunner test( argc, argv );
+
+   char self[PATH_MAX];
+
+   if ( !realpath( argv[0], self ) )
+   {
+      clog << "Error! Can't find the test program" << std::endl;
+      return 1;
+   }
+
+   // Output files of the runs, in a directory of their own.
+   const char * const tmp = std::getenv( "TMPDIR" );
+   std::string dir = std::string( tmp && *tmp ? tmp : "/tmp" ) + "/report-check.XXXXXX";
+
+   if ( !mkdtemp( &dir[0] ) )
+   {
+      clog << "Error! Can't make a directory for the output files" << std::endl;
+      return 1;
+   }
+
+   const std::string report = dir + "/report";
+   const std::string console = dir + "/console";
+
+   //=========================
+   // Test Streaming
+   //=========================
+   test = "Stream writes one JSON object per line, a result per check";
+   {
+      test( Run( self, dir, "report", { "--stream=report" } ) == 0 );
+      const std::vector<std::string> lines = Lines( report );
+      std::size_t objects = 0;
+
+      for ( std::size_t i = 0; i < lines.size(); ++i )
+      {
+         objects += StartsWith( lines[i], "{\"event\":\"" ) && lines[i].back() == '}';
+      }
+
+      test.eq( lines.size(), std::size_t( 8 ) );
+      test.eq( objects, lines.size() );
+      test( lines.size() == 8 &&
+            StartsWith( lines[0], "{\"event\":\"start\",\"test\":1," ) &&
+            StartsWith( lines[1], "{\"event\":\"result\",\"test\":1," ) &&
+            StartsWith( lines[2], "{\"event\":\"result\",\"test\":1," ) &&
+            StartsWith( lines[3], "{\"event\":\"start\",\"test\":2," ) &&
+            StartsWith( lines.back(), "{\"event\":\"summary\",\"tests\":4,\"passed\":3,\"failed\":1," ) );
+      test.should_pass();
+   }
+
+   //=========================
+   // Test Report Formats
+   //=========================
+   test = "JSON report numbers results by test block like the stream";
+   {
+      test( Run( self, dir, "report", { "--format=json", "--output=report" } ) == 0 );
+      const std::vector<std::string> lines = Lines( report );
+
+      test.eq( lines.size(), std::size_t( 5 ) );
+      test( lines.size() == 5 &&
+            StartsWith( lines[0], "{\"event\":\"result\",\"test\":1,\"description\":\"Two checks in one block\"" ) &&
+            StartsWith( lines[1], "{\"event\":\"result\",\"test\":1," ) &&
+            StartsWith( lines[2], "{\"event\":\"result\",\"test\":2," ) &&
+            lines[2].find( "\"status\":\"fail\"" ) != std::string::npos &&
+            lines.back() == "{\"event\":\"summary\",\"tests\":4,\"passed\":3,\"failed\":1}" );
+      test.should_pass();
+   }
+   test = "JUnit report has a testcase per check and the totals";
+   {
+      test( Run( self, dir, "report", { "--format=junit", "--output=report" } ) == 0 );
+      const std::string xml = Text( report );
+
+      test( StartsWith( xml, "<?xml" ) );
+      test.eq( Count( xml, "<testsuite " ), std::size_t( 1 ) );
+      test.eq( Count( xml, "<testcase " ), std::size_t( 4 ) );
+      test.eq( Count( xml, "<failure " ), std::size_t( 1 ) );
+      test( xml.find( "tests=\"4\" failures=\"1\"" ) != std::string::npos );
+      test( xml.find( "</testsuite>" ) != std::string::npos );
+      test.should_pass();
+   }
+   test = "TAP report has a result per check and the plan";
+   {
+      test( Run( self, dir, "report", { "--format=tap", "--output=report" } ) == 0 );
+      const std::vector<std::string> lines = Lines( report );
+      std::size_t ok = 0;
+      std::size_t not_ok = 0;
+
+      for ( std::size_t i = 0; i < lines.size(); ++i )
+      {
+         ok += StartsWith( lines[i], "ok " );
+         not_ok += StartsWith( lines[i], "not ok " );
+      }
+
+      test( !lines.empty() && lines[0] == "TAP version 13" && lines.back() == "1..4" );
+      test.eq( ok, std::size_t( 3 ) );
+      test.eq( not_ok, std::size_t( 1 ) );
+      test( Text( report ).find( "not ok 3 - Fails\n" ) != std::string::npos );
+      test.should_pass();
+   }
+
+   //=========================
+   // Test Repeat Mode
+   //=========================
+   test = "Repeat exits 0 when every check passes in every run";
+   {
+      test( Run( self, dir, "pass", { "--repeat=3" } ) == 0 );
+      test( Text( console ).find( "Repeat Summary: Runs(3) Checks(2) Flaky(0) Failed(0)" ) != std::string::npos );
+      test.should_pass();
+   }
+   test = "Repeat exits 1 on a check failing in every run";
+   {
+      test( Run( self, dir, "fail", { "--repeat=3" } ) == 1 );
+      test( Text( console ).find( "Checks(3) Flaky(0) Failed(1)" ) != std::string::npos );
+      test.should_pass();
+   }
+   test = "Repeat exits 1 on a flaky check";
+   {
+      std::remove( ( dir + "/runs" ).c_str() );
+      test( Run( self, dir, "flaky", { "--repeat=4" } ) == 1 );
+      const std::string text = Text( console );
+      test( text.find( "Flaky (2/4 passed) Fails every other run" ) != std::string::npos );
+      test( text.find( "Flaky(1) Failed(0)" ) != std::string::npos );
+      std::remove( ( dir + "/runs" ).c_str() );
+      test.should_pass();
+   }
+   test = "Repeat exits 1 on a run exiting with an error";
+   {
+      test( Run( self, dir, "exit", { "--repeat=2" } ) == 1 );
+      const std::string text = Text( console );
+      test( text.find( "Exited (status 1) run 1 in Exits from should_pass" ) != std::string::npos );
+      test( text.find( "Crashed(0) Exited(2)" ) != std::string::npos );
+      test.should_pass();
+   }
+
+   //=========================
+   // Test Profiling
+   //=========================
+   test = "Profile writes folded stacks of a slow check";
+   {
+      test( Run( self, dir, "report", { "--profile=20" } ) == 0 );
+      const std::vector<std::string> folded = Files( dir, ".folded" );
+      test.eq( folded.size(), std::size_t( 1 ) );
+      test( !folded.empty() && StartsWith( folded[0], "Slow_check." ) );
+      test( Text( console ).find( "Profile: " ) != std::string::npos );
+
+      for ( std::size_t i = 0; i < folded.size(); ++i )
+      {
+         std::remove( ( dir + "/" + folded[i] ).c_str() );
+      }
+
+      test.should_pass();
+   }
+
+#ifdef __linux__
+   //=========================
+   // Test Bench Environment
+   //=========================
+   test = "Bench env reports the pinned CPUs";
+   {
+      test( Run( self, dir, "pass", { "--bench-env" } ) == 0 );
+      test( Text( console ).find( "Bench env: timing tests pinned to cpu" ) != std::string::npos );
+      test.should_pass();
+   }
+   test = "Bench env with a CPU list that can't be read is an error";
+   {
+      test( Run( self, dir, "pass", { "--bench-env=x" } ) == 1 );
+      test.should_pass();
+   }
+#endif
+
+   std::remove( report.c_str() );
+   std::remove( console.c_str() );
+   rmdir( dir.c_str() );
+
+   // This MUST is the last line in the code.
+   clog << "\nMICRO TEST VERIFICATION SUCCESSFULL\n\n";
+}